@@ -26,8 +26,12 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <atomic>
+#include <future>
+#include <functional>
 #include <graph_core/metrics.h>
 #include <graph_core/graph/node.h>
+#include <penalty_cache.h>
 
 namespace pathplan
 {
@@ -37,6 +41,22 @@ typedef std::shared_ptr<CostPenalty> CostPenaltyPtr;
 class LengthPenaltyMetrics;
 typedef std::shared_ptr<LengthPenaltyMetrics> LengthPenaltyMetricsPtr;
 
+/**
+ * @brief ConfigurationsPair is a connection expressed as its (parent,child) configurations, ConfigurationsPairs is a batch of them.
+ */
+typedef std::pair<Eigen::VectorXd,Eigen::VectorXd> ConfigurationsPair;
+typedef std::vector<ConfigurationsPair> ConfigurationsPairs;
+
+/**
+ * @brief PenaltyCallback is called with the penalty of a connection submitted for asynchronous evaluation (see CostPenalty::submitPenalty).
+ */
+typedef std::function<void(const double&)> PenaltyCallback;
+
+/**
+ * @brief Waypoints is a path expressed as the sequence of its configurations, connection i goes from waypoint i to waypoint i+1.
+ */
+typedef std::vector<Eigen::VectorXd> Waypoints;
+
 /**
  * @brief The LengthPenaltyMetrics class computes the Euclidean distance between two nodes, and penalizes it based on a penalty.
  * Each joint can be weighted using a scale (default set to 1)
@@ -52,6 +72,13 @@ class LengthPenaltyMetrics: public Metrics
 protected:
   CostPenaltyPtr penalizer_; // computes lambda
   Eigen::VectorXd scale_; // scales the distance vector
+  PenaltyCachePtr cache_; // stores the lambdas already computed, nullptr if disabled
+
+  /**
+   * @brief computeLambda returns the penalty of connection (configuration1,configuration2), from cache_ when possible.
+   */
+  double computeLambda(const Eigen::VectorXd& configuration1,
+                       const Eigen::VectorXd& configuration2);
 
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -68,6 +95,9 @@ public:
   void setPenalizer(const CostPenaltyPtr& penalizer)
   {
     penalizer_ = penalizer;
+
+    if(cache_)  // cached penalties were computed by the previous penalizer
+      cache_->clear();
   }
 
   void setScale(const Eigen::VectorXd& scale)
@@ -80,12 +110,75 @@ public:
     return scale_;
   }
 
+  /**
+   * @brief enableCache enables a bounded cache of the penalties computed, so that repeated queries of the same connection
+   * do not call the penalizer again until its scene changes (see CostPenalty::getSceneVersion).
+   * @param capacity is the maximum number of penalties stored.
+   * @param resolution is the resolution used to quantize the configurations.
+   */
+  void enableCache(const size_t& capacity, const double& resolution=1e-06)
+  {
+    cache_ = std::make_shared<PenaltyCache>(capacity,resolution);
+  }
+
+  void disableCache()
+  {
+    cache_ = nullptr;
+  }
+
+  /**
+   * @brief getCache returns the cache, to read its statistics. It is nullptr if the cache is disabled.
+   */
+  PenaltyCachePtr getCache()
+  {
+    return cache_;
+  }
+
   virtual double cost(const NodePtr& node1,
                       const NodePtr& node2);
 
   virtual double cost(const Eigen::VectorXd& configuration1,
                       const Eigen::VectorXd& configuration2);
 
+  /**
+   * @brief cost computes the cost of the connection, but the computation may stop as soon as the cost is proven to be higher than cost_bound
+   * (e.g., a rewiring candidate which cannot improve the current cost).
+   * @param cost_bound is the cost of interest.
+   * @return the cost, if it is not higher than cost_bound. Otherwise, a value higher than cost_bound which is a lower bound of the cost.
+   */
+  virtual double cost(const NodePtr& node1,
+                      const NodePtr& node2,
+                      const double& cost_bound);
+
+  virtual double cost(const Eigen::VectorXd& configuration1,
+                      const Eigen::VectorXd& configuration2,
+                      const double& cost_bound);
+
+  /**
+   * @brief costs computes the cost of a batch of connections with a single call to the penalizer.
+   * @param connections is the vector of (configuration1,configuration2) pairs
+   * @return the vector of costs, in the same order of connections
+   */
+  virtual std::vector<double> costs(const ConfigurationsPairs& connections);
+
+  /**
+   * @brief submitCost submits the evaluation of the cost of the connection and returns without waiting for it (see CostPenalty::submitPenalty),
+   * so that the caller can do other work meanwhile. If the penalty is in cache, the returned future is already ready.
+   * The penalty is stored in cache by the thread evaluating it.
+   * @return the future cost of the connection.
+   */
+  virtual std::future<double> submitCost(const Eigen::VectorXd& configuration1,
+                                         const Eigen::VectorXd& configuration2);
+
+  /**
+   * @brief pathCost computes the cost of a whole path with a single call to the penalizer, which evaluates the path at once
+   * (see CostPenalty::computePathPenalties). If all the connections are in cache, the penalizer is not called.
+   * @param waypoints are the configurations of the path.
+   * @param lambdas is filled with the penalties of the connections (waypoints.size()-1 elements).
+   * @return the total cost of the path.
+   */
+  virtual double pathCost(const Waypoints& waypoints, std::vector<double>& lambdas);
+
 
   virtual double utopia(const NodePtr& node1,
                         const NodePtr& node2);
@@ -105,6 +198,17 @@ class CostPenalty
 protected:
   unsigned int verbose_;
 
+  /**
+   * @brief scene_version_ is increased every time something affecting the penalties changes (e.g., the obstacles positions),
+   * so that penalties computed before can be recognized as outdated.
+   */
+  std::atomic<unsigned long> scene_version_;
+
+  void increaseSceneVersion()
+  {
+    scene_version_++;
+  }
+
   /**
    * @brief computePenalty computes the penalty
    * @param q1 parent configuration
@@ -113,12 +217,90 @@ protected:
    */
   virtual double computePenalty(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2) = 0;
 
+  /**
+   * @brief computePenaltyBounded computes the penalty, but it may stop as soon as the penalty is proven to be higher than max_penalty.
+   * By default, it computes the exact penalty.
+   * @param q1 parent configuration
+   * @param q2 child configuration
+   * @param max_penalty is the penalty of interest
+   * @return the penalty, if it is not higher than max_penalty. Otherwise, a lower bound of the penalty higher than max_penalty.
+   */
+  virtual double computePenaltyBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& /*max_penalty*/)
+  {
+    return computePenalty(q1,q2);
+  }
+
+  /**
+   * @brief computePenalties computes the penalty of a batch of connections. By default, it calls computePenalty on each connection,
+   * override it when setup work can be shared among connections or connections can be evaluated in parallel.
+   * @param connections is the vector of (q1,q2) pairs
+   * @return the penalties computed, in the same order of connections
+   */
+  virtual std::vector<double> computePenalties(const ConfigurationsPairs& connections)
+  {
+    std::vector<double> penalties;
+    penalties.reserve(connections.size());
+
+    for(const ConfigurationsPair& connection:connections)
+      penalties.push_back(computePenalty(connection.first,connection.second));
+
+    return penalties;
+  }
+
+  /**
+   * @brief computePathPenalties computes the penalties of the connections of a path. By default, it calls computePenalties on the pairs of
+   * consecutive waypoints, override it when the path can be evaluated as a whole (e.g., its samples spread among threads at once).
+   * @param waypoints are the configurations of the path.
+   * @return the penalties of the connections, waypoints.size()-1 elements.
+   */
+  virtual std::vector<double> computePathPenalties(const Waypoints& waypoints)
+  {
+    ConfigurationsPairs connections;
+    for(size_t i=1;i<waypoints.size();i++)
+      connections.push_back(ConfigurationsPair(waypoints[i-1],waypoints[i]));
+
+    return computePenalties(connections);
+  }
+
+  /**
+   * @brief computePenaltyAsync starts the computation of the penalty and returns its future. By default, the penalty is computed by the
+   * calling thread and the returned future is already ready; override it when the penalizer owns threads to evaluate connections on.
+   * @param q1 parent configuration
+   * @param q2 child configuration
+   * @param callback is called with the penalty, by the thread computing it, before the future becomes ready (if not nullptr).
+   * @return the future penalty
+   */
+  virtual std::future<double> computePenaltyAsync(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const PenaltyCallback& callback)
+  {
+    std::promise<double> penalty;
+    try
+    {
+      double value = computePenalty(q1,q2);
+      if(callback)
+        callback(value);
+
+      penalty.set_value(value);
+    }
+    catch(...)
+    {
+      penalty.set_exception(std::current_exception());
+    }
+
+    return penalty.get_future();
+  }
+
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   CostPenalty()
   {
     verbose_ = 0;
+    scene_version_ = 0;
+  }
+
+  unsigned long getSceneVersion()
+  {
+    return scene_version_;
   }
 
   virtual void setVerbose(const unsigned int& verbose)
@@ -140,6 +322,68 @@ public:
     return penalty;
   }
 
+  /**
+   * @brief getPenaltyBounded computes and return the penalty, stopping as soon as it is proven to be higher than max_penalty
+   * @param q1 parent configuration
+   * @param q2 child configuration
+   * @param max_penalty is the penalty of interest
+   * @return the penalty, if it is not higher than max_penalty. Otherwise, a lower bound of the penalty higher than max_penalty.
+   */
+  virtual double getPenaltyBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_penalty)
+  {
+    double penalty = computePenaltyBounded(q1,q2,max_penalty);
+    assert(penalty >= 1.0);
+
+    return penalty;
+  }
+
+  /**
+   * @brief getPenalties computes and return the penalties of a batch of connections
+   * @param connections is the vector of (q1,q2) pairs
+   * @return the penalties computed, in the same order of connections
+   */
+  virtual std::vector<double> getPenalties(const ConfigurationsPairs& connections)
+  {
+    std::vector<double> penalties = computePenalties(connections);
+    assert(penalties.size() == connections.size());
+    assert(std::all_of(penalties.begin(),penalties.end(),[](const double& penalty){return penalty>=1.0;}));
+
+    return penalties;
+  }
+
+  /**
+   * @brief getPathPenalties computes and return the penalties of the connections of a path
+   * @param waypoints are the configurations of the path
+   * @return the penalties computed, waypoints.size()-1 elements
+   */
+  virtual std::vector<double> getPathPenalties(const Waypoints& waypoints)
+  {
+    std::vector<double> penalties = computePathPenalties(waypoints);
+    assert(penalties.size() == std::max(waypoints.size(),(size_t) 1)-1);
+    assert(std::all_of(penalties.begin(),penalties.end(),[](const double& penalty){return penalty>=1.0;}));
+
+    return penalties;
+  }
+
+  /**
+   * @brief submitPenalty submits the computation of the penalty and returns without waiting for it, if the penalizer supports it
+   * (see computePenaltyAsync). The penalizer may block the caller when too many penalties are already being computed.
+   * The scene must not be changed until the submitted penalties have been computed, see waitForSubmittedPenalties.
+   * @param q1 parent configuration
+   * @param q2 child configuration
+   * @param callback is called with the penalty, by the thread computing it, before the future becomes ready (if not nullptr).
+   * @return the future penalty
+   */
+  virtual std::future<double> submitPenalty(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const PenaltyCallback& callback=nullptr)
+  {
+    return computePenaltyAsync(q1,q2,callback);
+  }
+
+  /**
+   * @brief waitForSubmittedPenalties waits until all the penalties submitted by submitPenalty have been computed.
+   */
+  virtual void waitForSubmittedPenalties(){}
+
   /**
    * @brief clone clones the object
    * @return a cloned object
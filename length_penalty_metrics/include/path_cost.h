@@ -0,0 +1,128 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <length_penalty_metrics.h>
+
+namespace pathplan
+{
+class PathCost;
+typedef std::shared_ptr<PathCost> PathCostPtr;
+
+/**
+ * @brief The PathCost class stores the cost of each connection of a path and their partial sums in a segment tree, so that the cost of the path
+ * and of any range of its connections is available in O(log n). After a local edit (e.g., a moved waypoint or a shortcut of a window), only the
+ * connections touched by the edit are evaluated again by the metrics, as a single path (see LengthPenaltyMetrics::pathCost).
+ * The costs refer to the scene of the penalizer when they were computed, call update when it changes (see isUpToDate).
+ */
+class PathCost
+{
+protected:
+  LengthPenaltyMetricsPtr metrics_;
+  Waypoints waypoints_;
+
+  /**
+   * @brief tree_ is the segment tree of the costs: the cost of connection i is leaf n_leaves_+i, each internal node k is the sum of
+   * nodes 2k and 2k+1, so tree_[1] is the cost of the path. n_leaves_ is a power of two not lower than the number of connections.
+   */
+  std::vector<double> tree_;
+  size_t n_leaves_;
+
+  /**
+   * @brief scene_version_ is the scene version of the penalizer when the costs were computed.
+   */
+  unsigned long scene_version_;
+
+  /**
+   * @brief computeCosts evaluates the connections between waypoints first_waypoint and last_waypoint.
+   * @param costs is filled with the costs of the last_waypoint-first_waypoint connections.
+   */
+  void computeCosts(const size_t& first_waypoint, const size_t& last_waypoint, std::vector<double>& costs);
+
+  /**
+   * @brief build rebuilds the tree from the costs of all the connections, in O(n).
+   */
+  void build(const std::vector<double>& costs);
+
+  /**
+   * @brief setCost sets the cost of a connection and updates the partial sums, in O(log n).
+   */
+  void setCost(const size_t& connection, const double& cost);
+
+public:
+  PathCost(const LengthPenaltyMetricsPtr& metrics);
+  PathCost(const LengthPenaltyMetricsPtr& metrics, const Waypoints& waypoints);
+
+  /**
+   * @brief setWaypoints sets the path and evaluates all its connections.
+   */
+  void setWaypoints(const Waypoints& waypoints);
+  const Waypoints& getWaypoints(){return waypoints_;}
+
+  size_t getConnectionsNumber(){return std::max(waypoints_.size(),(size_t) 1)-1;}
+
+  /**
+   * @brief moveWaypoint changes waypoint idx and evaluates again its (at most two) connections.
+   */
+  void moveWaypoint(const size_t& idx, const Eigen::VectorXd& waypoint);
+
+  /**
+   * @brief replaceWaypoints replaces the waypoints in [first,last] with waypoints (e.g., a shortcut of a window of the path: first and last are
+   * the waypoints of the window to remove, waypoints the new ones between first-1 and last+1, possibly none). Only the new connections are evaluated.
+   * If the number of connections changes, the tree is rebuilt from the costs in O(n), without evaluating the other connections again.
+   */
+  void replaceWaypoints(const size_t& first, const size_t& last, const Waypoints& waypoints);
+
+  /**
+   * @brief update evaluates again all the connections (e.g., after the obstacles moved).
+   */
+  void update();
+
+  /**
+   * @brief isUpToDate tells if the costs refer to the current scene of the penalizer.
+   */
+  bool isUpToDate(){return scene_version_ == metrics_->getPenalizer()->getSceneVersion();}
+
+  /**
+   * @brief getCost returns the cost of the path.
+   */
+  double getCost(){return tree_.empty()? 0.0: tree_[1];}
+
+  /**
+   * @brief getCost returns the cost of the connections in [first_connection,last_connection], in O(log n). Connection i goes from waypoint i to waypoint i+1.
+   */
+  double getCost(const size_t& first_connection, const size_t& last_connection);
+
+  double getConnectionCost(const size_t& connection)
+  {
+    assert(connection<getConnectionsNumber());
+    return tree_[n_leaves_+connection];
+  }
+};
+
+}
@@ -0,0 +1,129 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <list>
+#include <ros/ros.h>
+#include <mutex>
+#include <unordered_map>
+#include <eigen3/Eigen/Core>
+
+namespace pathplan
+{
+class PenaltyCache;
+typedef std::shared_ptr<PenaltyCache> PenaltyCachePtr;
+
+/**
+ * @brief The ConnectionKey struct identifies a connection (q1,q2) evaluated in a given scene. Configurations are quantized
+ * with a given resolution, so that numerically equivalent configurations share the same key.
+ */
+struct ConnectionKey
+{
+  std::vector<long> q1_;
+  std::vector<long> q2_;
+  unsigned long scene_version_;
+
+  ConnectionKey(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& resolution, const unsigned long& scene_version);
+
+  bool operator==(const ConnectionKey& other) const
+  {
+    return (scene_version_ == other.scene_version_ && q1_ == other.q1_ && q2_ == other.q2_);
+  }
+};
+
+struct ConnectionKeyHash
+{
+  size_t operator()(const ConnectionKey& key) const;
+};
+
+/**
+ * @brief The PenaltyCache class is a bounded least-recently-used cache of the penalties of connections.
+ * Penalties are stored with the scene version of the penalizer which computed them, so a penalty computed
+ * before a change of the scene (e.g., obstacles moved) is never returned. Stale entries are evicted as the least recently used ones.
+ */
+class PenaltyCache
+{
+protected:
+  typedef std::pair<ConnectionKey,double> Entry;
+
+  /**
+   * @brief capacity_ is the maximum number of stored penalties.
+   */
+  size_t capacity_;
+
+  /**
+   * @brief resolution_ is the quantization step of the configurations in the keys.
+   */
+  double resolution_;
+
+  /**
+   * @brief entries_ stores the penalties from the most to the least recently used, map_ indexes them by key.
+   */
+  std::list<Entry> entries_;
+  std::unordered_map<ConnectionKey,std::list<Entry>::iterator,ConnectionKeyHash> map_;
+
+  /**
+   * @brief Statistics
+   */
+  unsigned long hits_;
+  unsigned long misses_;
+  unsigned long evictions_;
+
+  std::mutex mtx_;
+
+public:
+  PenaltyCache(const size_t& capacity, const double& resolution=1e-06);
+
+  /**
+   * @brief find looks for the penalty of connection (q1,q2) computed in scene scene_version.
+   * @param penalty is filled with the cached penalty, if found.
+   * @return true if the penalty is in the cache.
+   */
+  bool find(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const unsigned long& scene_version, double& penalty);
+
+  /**
+   * @brief insert stores the penalty of connection (q1,q2) computed in scene scene_version. If the cache is full, the least recently used penalty is evicted.
+   */
+  void insert(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const unsigned long& scene_version, const double& penalty);
+
+  void clear();
+  void resetStatistics();
+
+  size_t size();
+  size_t getCapacity(){return capacity_;}
+  double getResolution(){return resolution_;}
+
+  unsigned long getHits();
+  unsigned long getMisses();
+  unsigned long getEvictions();
+  double getHitRate();
+
+  friend std::ostream& operator<<(std::ostream& os, PenaltyCache& cache);
+};
+
+}
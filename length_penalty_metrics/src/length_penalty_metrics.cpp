@@ -45,7 +45,7 @@ double LengthPenaltyMetrics::cost(const Eigen::VectorXd& configuration1,
   if(configuration1 == configuration2)
     lambda = 1.0;  //cost will be zero..
   else
-    lambda = penalizer_->getPenalty(configuration1,configuration2);
+    lambda = computeLambda(configuration1,configuration2);
 
   assert([&]() ->bool{
            if(lambda>=1.0)
@@ -68,6 +68,226 @@ double LengthPenaltyMetrics::cost(const Eigen::VectorXd& configuration1,
   return (LengthPenaltyMetrics::utopia(configuration1,configuration2))*lambda;
 }
 
+double LengthPenaltyMetrics::cost(const NodePtr& node1,
+                                  const NodePtr& node2,
+                                  const double& cost_bound)
+{
+  return LengthPenaltyMetrics::cost(node1->getConfiguration(),node2->getConfiguration(),cost_bound);
+}
+
+double LengthPenaltyMetrics::cost(const Eigen::VectorXd& configuration1,
+                                  const Eigen::VectorXd& configuration2,
+                                  const double& cost_bound)
+{
+  if(configuration1 == configuration2)
+    return 0.0;
+
+  double length = LengthPenaltyMetrics::utopia(configuration1,configuration2);
+  double max_lambda = cost_bound/length;
+
+  double lambda;
+  unsigned long scene_version = penalizer_->getSceneVersion();
+
+  if(not (cache_ && cache_->find(configuration1,configuration2,scene_version,lambda)))
+  {
+    lambda = penalizer_->getPenaltyBounded(configuration1,configuration2,max_lambda);
+
+    if(cache_ && lambda<=max_lambda)  // only exact penalties are stored
+      cache_->insert(configuration1,configuration2,scene_version,lambda);
+  }
+
+  assert(lambda>=1.0);
+
+  if(lambda == std::numeric_limits<double>::infinity()) //set high cost but not infinite (infinity is used to trigger an obstruction)
+    lambda = lambda_penalty_;
+
+  return length*lambda;
+}
+
+std::vector<double> LengthPenaltyMetrics::costs(const ConfigurationsPairs& connections)
+{
+  std::vector<double> costs(connections.size(),0.0);
+
+  /* Coincident configurations have zero cost, send to the penalizer only the other connections not already in cache */
+  double lambda;
+  std::vector<size_t> idxs;
+  idxs.reserve(connections.size());
+  unsigned long scene_version = penalizer_->getSceneVersion();
+
+  for(size_t i=0;i<connections.size();i++)
+  {
+    if(connections[i].first == connections[i].second)
+      continue;
+
+    if(cache_ && cache_->find(connections[i].first,connections[i].second,scene_version,lambda))
+    {
+      if(lambda == std::numeric_limits<double>::infinity())
+        lambda = lambda_penalty_;
+
+      costs[i] = (LengthPenaltyMetrics::utopia(connections[i].first,connections[i].second))*lambda;
+    }
+    else
+      idxs.push_back(i);
+  }
+
+  if(idxs.empty())
+    return costs;
+
+  std::vector<double> lambdas;
+  if(idxs.size() == connections.size())
+    lambdas = penalizer_->getPenalties(connections);
+  else
+  {
+    ConfigurationsPairs to_penalize;
+    to_penalize.reserve(idxs.size());
+    for(const size_t& i:idxs)
+      to_penalize.push_back(connections[i]);
+
+    lambdas = penalizer_->getPenalties(to_penalize);
+  }
+
+  assert(lambdas.size() == idxs.size());
+
+  for(size_t j=0;j<idxs.size();j++)
+  {
+    lambda = lambdas[j];
+    assert(lambda>=1.0);
+
+    if(cache_)
+      cache_->insert(connections[idxs[j]].first,connections[idxs[j]].second,scene_version,lambda);
+
+    if(lambda == std::numeric_limits<double>::infinity()) //set high cost but not infinite (infinity is used to trigger an obstruction)
+      lambda = lambda_penalty_;
+
+    const ConfigurationsPair& connection = connections[idxs[j]];
+    costs[idxs[j]] = (LengthPenaltyMetrics::utopia(connection.first,connection.second))*lambda;
+  }
+
+  return costs;
+}
+
+std::future<double> LengthPenaltyMetrics::submitCost(const Eigen::VectorXd& configuration1,
+                                                     const Eigen::VectorXd& configuration2)
+{
+  std::shared_ptr<std::promise<double>> cost = std::make_shared<std::promise<double>>();
+  std::future<double> future_cost = cost->get_future();
+
+  if(configuration1 == configuration2)
+  {
+    cost->set_value(0.0);
+    return future_cost;
+  }
+
+  double length = LengthPenaltyMetrics::utopia(configuration1,configuration2);
+
+  double lambda;
+  unsigned long scene_version = penalizer_->getSceneVersion();
+
+  if(cache_ && cache_->find(configuration1,configuration2,scene_version,lambda))
+  {
+    if(lambda == std::numeric_limits<double>::infinity()) //set high cost but not infinite (infinity is used to trigger an obstruction)
+      lambda = lambda_penalty_;
+
+    cost->set_value(length*lambda);
+    return future_cost;
+  }
+
+  /* The cost is set by the thread computing the penalty. If the penalty computation throws, the promise is destroyed unset
+   * and the future reports a broken promise */
+  PenaltyCachePtr cache = cache_;
+  penalizer_->submitPenalty(configuration1,configuration2,[cost,cache,configuration1,configuration2,scene_version,length](const double& penalty){
+    assert(penalty>=1.0);
+
+    if(cache)
+      cache->insert(configuration1,configuration2,scene_version,penalty);
+
+    //set high cost but not infinite (infinity is used to trigger an obstruction)
+    cost->set_value(length*((penalty == std::numeric_limits<double>::infinity())? lambda_penalty_: penalty));
+  });
+
+  return future_cost;
+}
+
+double LengthPenaltyMetrics::pathCost(const Waypoints& waypoints, std::vector<double>& lambdas)
+{
+  lambdas.assign(std::max(waypoints.size(),(size_t) 1)-1,1.0);
+  if(lambdas.empty())
+    return 0.0;
+
+  /* The penalizer is called only if some connection is not in cache, and then it evaluates the whole path */
+  bool cached = (cache_ != nullptr);
+  unsigned long scene_version = penalizer_->getSceneVersion();
+
+  for(size_t i=0;i<lambdas.size() && cached;i++)
+  {
+    if(waypoints[i] != waypoints[i+1])
+      cached = cache_->find(waypoints[i],waypoints[i+1],scene_version,lambdas[i]);
+  }
+
+  if(not cached)
+  {
+    /* Coincident consecutive waypoints have zero cost, send to the penalizer only the path without them */
+    std::vector<size_t> idxs;
+    Waypoints path(1,waypoints[0]);
+    for(size_t i=0;i<lambdas.size();i++)
+    {
+      if(waypoints[i] != waypoints[i+1])
+      {
+        idxs.push_back(i);
+        path.push_back(waypoints[i+1]);
+      }
+    }
+
+    std::vector<double> path_lambdas;
+    if(not idxs.empty())
+      path_lambdas = penalizer_->getPathPenalties(path);
+
+    for(size_t j=0;j<idxs.size();j++)
+    {
+      lambdas[idxs[j]] = path_lambdas[j];
+
+      if(cache_)
+        cache_->insert(waypoints[idxs[j]],waypoints[idxs[j]+1],scene_version,path_lambdas[j]);
+    }
+  }
+
+  double lambda;
+  double cost = 0.0;
+  for(size_t i=0;i<lambdas.size();i++)
+  {
+    if(waypoints[i] == waypoints[i+1])
+      continue;  //cost is zero, lambda is 1.0
+
+    lambda = lambdas[i];
+    assert(lambda>=1.0);
+
+    if(lambda == std::numeric_limits<double>::infinity()) //set high cost but not infinite (infinity is used to trigger an obstruction)
+      lambda = lambda_penalty_;
+
+    cost += (LengthPenaltyMetrics::utopia(waypoints[i],waypoints[i+1]))*lambda;
+  }
+
+  return cost;
+}
+
+double LengthPenaltyMetrics::computeLambda(const Eigen::VectorXd& configuration1,
+                                           const Eigen::VectorXd& configuration2)
+{
+  if(not cache_)
+    return penalizer_->getPenalty(configuration1,configuration2);
+
+  double lambda;
+  unsigned long scene_version = penalizer_->getSceneVersion();
+
+  if(not cache_->find(configuration1,configuration2,scene_version,lambda))
+  {
+    lambda = penalizer_->getPenalty(configuration1,configuration2);
+    cache_->insert(configuration1,configuration2,scene_version,lambda);
+  }
+
+  return lambda;
+}
+
 double LengthPenaltyMetrics::utopia(const NodePtr& node1,
                                     const NodePtr& node2)
 {
@@ -89,7 +309,12 @@ double LengthPenaltyMetrics::utopia(const Eigen::VectorXd& configuration1,
 MetricsPtr LengthPenaltyMetrics::clone()
 {
   CostPenaltyPtr penalizer_cloned = penalizer_->clone();
-  return std::make_shared<LengthPenaltyMetrics>(penalizer_cloned,scale_);
+  LengthPenaltyMetricsPtr cloned_metrics = std::make_shared<LengthPenaltyMetrics>(penalizer_cloned,scale_);
+
+  if(cache_)
+    cloned_metrics->enableCache(cache_->getCapacity(),cache_->getResolution());
+
+  return cloned_metrics;
 }
 
 }
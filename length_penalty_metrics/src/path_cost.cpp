@@ -0,0 +1,190 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <path_cost.h>
+
+namespace pathplan
+{
+PathCost::PathCost(const LengthPenaltyMetricsPtr& metrics):
+  metrics_(metrics)
+{
+  setWaypoints(Waypoints());
+}
+
+PathCost::PathCost(const LengthPenaltyMetricsPtr& metrics, const Waypoints& waypoints):
+  metrics_(metrics)
+{
+  setWaypoints(waypoints);
+}
+
+void PathCost::computeCosts(const size_t& first_waypoint, const size_t& last_waypoint, std::vector<double>& costs)
+{
+  costs.clear();
+  if(last_waypoint<=first_waypoint)
+    return;
+
+  Waypoints waypoints(waypoints_.begin()+first_waypoint,waypoints_.begin()+last_waypoint+1);
+
+  std::vector<double> lambdas;
+  metrics_->pathCost(waypoints,lambdas);
+
+  costs.resize(lambdas.size());
+  for(size_t i=0;i<lambdas.size();i++)
+  {
+    if(lambdas[i] == std::numeric_limits<double>::infinity()) //same high cost of LengthPenaltyMetrics::cost
+      lambdas[i] = LengthPenaltyMetrics::lambda_penalty_;
+
+    costs[i] = metrics_->utopia(waypoints[i],waypoints[i+1])*lambdas[i];
+  }
+}
+
+void PathCost::build(const std::vector<double>& costs)
+{
+  n_leaves_ = 1;
+  while(n_leaves_<costs.size())
+    n_leaves_ *= 2;
+
+  tree_.assign(2*n_leaves_,0.0);
+  std::copy(costs.begin(),costs.end(),tree_.begin()+n_leaves_);
+
+  for(size_t k=n_leaves_-1;k>0;k--)
+    tree_[k] = tree_[2*k]+tree_[2*k+1];
+}
+
+void PathCost::setCost(const size_t& connection, const double& cost)
+{
+  size_t k = n_leaves_+connection;
+  tree_[k] = cost;
+
+  for(k/=2;k>0;k/=2)
+    tree_[k] = tree_[2*k]+tree_[2*k+1];
+}
+
+void PathCost::setWaypoints(const Waypoints& waypoints)
+{
+  waypoints_ = waypoints;
+  update();
+}
+
+void PathCost::update()
+{
+  scene_version_ = metrics_->getPenalizer()->getSceneVersion();
+
+  std::vector<double> costs;
+  computeCosts(0,std::max(waypoints_.size(),(size_t) 1)-1,costs);
+  build(costs);
+}
+
+void PathCost::moveWaypoint(const size_t& idx, const Eigen::VectorXd& waypoint)
+{
+  if(idx>=waypoints_.size())
+    throw std::invalid_argument("waypoint index out of range");
+
+  waypoints_[idx] = waypoint;
+
+  /* The connections ending and starting at the waypoint */
+  size_t first_waypoint = (idx>0)? idx-1: 0;
+  size_t last_waypoint = std::min(idx+1,waypoints_.size()-1);
+
+  std::vector<double> costs;
+  computeCosts(first_waypoint,last_waypoint,costs);
+
+  for(size_t j=0;j<costs.size();j++)
+    setCost(first_waypoint+j,costs[j]);
+}
+
+void PathCost::replaceWaypoints(const size_t& first, const size_t& last, const Waypoints& waypoints)
+{
+  if(first>last || last>=waypoints_.size())
+    throw std::invalid_argument("invalid range of waypoints");
+
+  size_t n_removed = last-first+1;
+  std::vector<double> old_costs(tree_.begin()+n_leaves_,tree_.begin()+n_leaves_+getConnectionsNumber());
+
+  waypoints_.erase(waypoints_.begin()+first,waypoints_.begin()+last+1);
+  waypoints_.insert(waypoints_.begin()+first,waypoints.begin(),waypoints.end());
+
+  if(waypoints_.size()<2)
+  {
+    build(std::vector<double>());
+    return;
+  }
+
+  /* The new connections go from the waypoint before the window to the waypoint after it */
+  size_t first_waypoint = (first>0)? first-1: 0;
+  size_t last_waypoint = std::min(first+waypoints.size(),waypoints_.size()-1);
+
+  std::vector<double> new_costs;
+  computeCosts(first_waypoint,last_waypoint,new_costs);
+
+  if(waypoints.size() == n_removed)
+  {
+    for(size_t j=0;j<new_costs.size();j++)
+      setCost(first_waypoint+j,new_costs[j]);
+  }
+  else
+  {
+    /* The connections after the window are shifted */
+    std::vector<double> costs(getConnectionsNumber());
+    for(size_t i=0;i<first_waypoint;i++)
+      costs[i] = old_costs[i];
+
+    for(size_t j=0;j<new_costs.size();j++)
+      costs[first_waypoint+j] = new_costs[j];
+
+    for(size_t i=last_waypoint;i<costs.size();i++)
+      costs[i] = old_costs[i+n_removed-waypoints.size()];
+
+    build(costs);
+  }
+}
+
+double PathCost::getCost(const size_t& first_connection, const size_t& last_connection)
+{
+  if(first_connection>last_connection || last_connection>=getConnectionsNumber())
+    throw std::invalid_argument("invalid range of connections");
+
+  double cost = 0.0;
+  size_t lo = n_leaves_+first_connection;
+  size_t hi = n_leaves_+last_connection+1;
+
+  while(lo<hi)
+  {
+    if(lo%2 == 1)
+      cost += tree_[lo++];
+    if(hi%2 == 1)
+      cost += tree_[--hi];
+
+    lo /= 2;
+    hi /= 2;
+  }
+
+  return cost;
+}
+
+}
@@ -0,0 +1,173 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <penalty_cache.h>
+
+namespace pathplan
+{
+ConnectionKey::ConnectionKey(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& resolution, const unsigned long& scene_version):
+  scene_version_(scene_version)
+{
+  q1_.resize(q1.size());
+  q2_.resize(q2.size());
+
+  for(Eigen::Index i=0;i<q1.size();i++)
+    q1_[i] = std::lround(q1[i]/resolution);
+
+  for(Eigen::Index i=0;i<q2.size();i++)
+    q2_[i] = std::lround(q2[i]/resolution);
+}
+
+size_t ConnectionKeyHash::operator()(const ConnectionKey& key) const
+{
+  size_t seed = std::hash<unsigned long>()(key.scene_version_);
+  auto combine = [&seed](const long& v){seed ^= std::hash<long>()(v)+0x9e3779b9+(seed<<6)+(seed>>2);};
+
+  std::for_each(key.q1_.begin(),key.q1_.end(),combine);
+  std::for_each(key.q2_.begin(),key.q2_.end(),combine);
+
+  return seed;
+}
+
+PenaltyCache::PenaltyCache(const size_t& capacity, const double& resolution):
+  capacity_(capacity),resolution_(resolution)
+{
+  if(capacity_ == 0)
+  {
+    ROS_ERROR("cache capacity must be positive, set equal to 1");
+    capacity_ = 1;
+  }
+
+  if(resolution_<=0.0)
+  {
+    ROS_ERROR("cache resolution must be positive, set equal to 1e-06");
+    resolution_ = 1e-06;
+  }
+
+  map_.reserve(capacity_);
+  resetStatistics();
+}
+
+bool PenaltyCache::find(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const unsigned long& scene_version, double& penalty)
+{
+  ConnectionKey key(q1,q2,resolution_,scene_version);
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = map_.find(key);
+  if(it == map_.end())
+  {
+    misses_++;
+    return false;
+  }
+
+  entries_.splice(entries_.begin(),entries_,it->second);  // move it in front, iterators stay valid
+  penalty = it->second->second;
+  hits_++;
+
+  return true;
+}
+
+void PenaltyCache::insert(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const unsigned long& scene_version, const double& penalty)
+{
+  ConnectionKey key(q1,q2,resolution_,scene_version);
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = map_.find(key);
+  if(it != map_.end())
+  {
+    it->second->second = penalty;
+    entries_.splice(entries_.begin(),entries_,it->second);
+    return;
+  }
+
+  if(map_.size()>=capacity_)
+  {
+    map_.erase(entries_.back().first);
+    entries_.pop_back();
+    evictions_++;
+  }
+
+  entries_.emplace_front(key,penalty);
+  map_.emplace(std::move(key),entries_.begin());
+}
+
+void PenaltyCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  map_.clear();
+  entries_.clear();
+}
+
+void PenaltyCache::resetStatistics()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  hits_ = 0;
+  misses_ = 0;
+  evictions_ = 0;
+}
+
+size_t PenaltyCache::size()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return map_.size();
+}
+
+unsigned long PenaltyCache::getHits()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return hits_;
+}
+
+unsigned long PenaltyCache::getMisses()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return misses_;
+}
+
+unsigned long PenaltyCache::getEvictions()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return evictions_;
+}
+
+double PenaltyCache::getHitRate()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  unsigned long queries = hits_+misses_;
+  return (queries>0)? ((double) hits_)/((double) queries): 0.0;
+}
+
+std::ostream& operator<<(std::ostream& os, PenaltyCache& cache)
+{
+  os<<"cache size: "<<cache.size()<<"/"<<cache.getCapacity()<<" | hits: "<<cache.getHits()<<" | misses: "<<cache.getMisses()
+   <<" | hit rate: "<<cache.getHitRate()*100.0<<"% | evictions: "<<cache.getEvictions();
+
+  return os;
+}
+
+}
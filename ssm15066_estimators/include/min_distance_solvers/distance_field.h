@@ -0,0 +1,143 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <memory>
+#include <vector>
+#include <eigen3/Eigen/Core>
+
+namespace ssm15066_estimator
+{
+class DistanceField;
+typedef std::shared_ptr<DistanceField> DistanceFieldPtr;
+
+/**
+ * @brief The DistanceField class stores, at the nodes of a regular grid over a bounded workcell, the distance from the closest obstacle.
+ * It is a pre-filter: a lower bound of the distance at any point of the workcell is read in constant time, whatever the number of obstacles is,
+ * so that the points provably far from the obstacles can be discarded without looping over them. The points near the obstacles are still
+ * evaluated over all the obstacles, so the cost of a query is constant only far from them. The field is built with a separable Euclidean distance
+ * transform (Felzenszwalb and Huttenlocher), which finds the closest obstacle of each node, then the distances are computed from the actual obstacles
+ * positions. The obstacles outside the workcell are not in the grid, their distance is computed at each query. Queries are const and thread-safe.
+ */
+class DistanceField
+{
+protected:
+  Eigen::Vector3d min_corner_;
+  Eigen::Vector3d max_corner_;
+  double resolution_;
+  double inv_resolution_;
+
+  /**
+   * @brief n_nodes_ is the number of nodes along x, y and z. Node (i,j,k) is at min_corner_+resolution_*(i,j,k).
+   */
+  Eigen::Matrix<Eigen::Index,3,1> n_nodes_;
+
+  /**
+   * @brief points_ is a copy of the obstacles positions.
+   */
+  Eigen::Matrix<double,3,Eigen::Dynamic> points_;
+
+  /**
+   * @brief outside_ are the indexes of the obstacles outside the workcell.
+   */
+  std::vector<Eigen::Index> outside_;
+
+  bool isInside(const Eigen::Vector3d& point) const
+  {
+    return (point-min_corner_).minCoeff()>=0.0 && (max_corner_-point).minCoeff()>=0.0;
+  }
+
+  /**
+   * @brief distances_ and nearest_ are the distance from the closest obstacle and its index for each node.
+   */
+  Eigen::VectorXd distances_;
+  std::vector<Eigen::Index> nearest_;
+
+  Eigen::Index nodeIndex(const Eigen::Index& i, const Eigen::Index& j, const Eigen::Index& k) const
+  {
+    return i+n_nodes_(0)*(j+n_nodes_(1)*k);
+  }
+
+  Eigen::Vector3d nodePosition(const Eigen::Index& i, const Eigen::Index& j, const Eigen::Index& k) const
+  {
+    return min_corner_+resolution_*Eigen::Vector3d(i,j,k);
+  }
+
+  /**
+   * @brief transformLines computes the 1D squared distance transform along dimension dim, for all the lines of the grid.
+   * @param squared_distances are the squared distances (in nodes units) of the nodes, updated in place.
+   * @param features are the indexes of the closest obstacles of the nodes, updated in place.
+   */
+  void transformLines(const unsigned int& dim, std::vector<double>& squared_distances, std::vector<Eigen::Index>& features) const;
+
+  /**
+   * @brief updateNode computes the distance of node (i,j,k) from its closest obstacle nearest_[idx].
+   */
+  void updateNode(const Eigen::Index& i, const Eigen::Index& j, const Eigen::Index& k);
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /**
+   * @brief DistanceField
+   * @param min_corner and max_corner are the corners of the workcell, max_corner must be higher than min_corner along each axis.
+   * @param resolution is the distance between adjacent nodes, it must be positive.
+   */
+  DistanceField(const Eigen::Vector3d& min_corner, const Eigen::Vector3d& max_corner, const double& resolution);
+
+  /**
+   * @brief build computes the field of obstacles_positions, discarding the previous obstacles.
+   */
+  void build(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions);
+
+  /**
+   * @brief add adds an obstacle, updating the nodes closer to it than to the previous obstacles.
+   */
+  void add(const Eigen::Vector3d& obstacle_position);
+
+  /**
+   * @brief lowerBound reads a lower bound of the distance of point from the closest obstacle: the distance interpolated over the nodes
+   * of the cell minus getMaxError, or the distance from an obstacle outside the workcell if lower.
+   * @param distance is filled with the lower bound, std::numeric_limits<double>::max() if there are no obstacles.
+   * @return false if point is outside the workcell.
+   */
+  bool lowerBound(const Eigen::Vector3d& point, double& distance) const;
+
+  Eigen::Index size() const {return points_.cols();}
+  Eigen::Vector3d getMinCorner() const {return min_corner_;}
+  Eigen::Vector3d getMaxCorner() const {return max_corner_;}
+  double getResolution() const {return resolution_;}
+
+  /**
+   * @brief getMaxError is the maximum overestimation of the interpolated distance: the distance of a node is at most sqrt(3)*resolution_ higher than
+   * the actual one (the obstacles are snapped to the nodes), and the interpolation adds at most sqrt(1.5)*resolution_ (the distance is 1-Lipschitz).
+   */
+  double getMaxError() const {return resolution_*(std::sqrt(3.0)+std::sqrt(1.5));}
+};
+
+}
@@ -28,6 +28,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <rosdyn_core/primitives.h>
 #include <min_distance_solvers/util.h>
+#include <min_distance_solvers/obstacles_index.h>
+#include <min_distance_solvers/distance_field.h>
+#include <ssm15066_estimators/poi_kinematics.h>
 
 namespace ssm15066_estimator
 {
@@ -60,6 +63,34 @@ protected:
    */
   std::vector<std::string> links_names_;
 
+  /**
+   * @brief poi_kinematics_ computes the positions of the pois only.
+   */
+  PoiKinematics poi_kinematics_;
+
+  /**
+   * @brief obstacles_index_ is a k-d tree over obstacles_positions_, rebuilt every time the obstacles change.
+   */
+  ObstaclesIndexPtr obstacles_index_;
+
+  /**
+   * @brief obstacles_index_threshold_ is the minimum number of obstacles to use obstacles_index_, below it a linear scan is faster.
+   */
+  unsigned int obstacles_index_threshold_;
+
+  /**
+   * @brief distance_field_ stores the distance from the closest obstacle over the workcell, nullptr if disabled.
+   * It is rebuilt when the obstacles change only if update_distance_field_ is true (e.g., it may be shared by many solvers and updated by one of them).
+   */
+  DistanceFieldPtr distance_field_;
+  bool update_distance_field_;
+
+  /**
+   * @brief computePoiMinDistance computes the distance of poi_position from the closest obstacle, with obstacles_index_ if there are enough obstacles.
+   * @param i_obs is filled with the index of the closest obstacle.
+   */
+  double computePoiMinDistance(const Eigen::Vector3d& poi_position, Eigen::Index& i_obs);
+
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   MinDistanceSolver(const rosdyn::ChainPtr& chain);
@@ -67,9 +98,43 @@ public:
 
   rosdyn::ChainPtr getChain(){return chain_;}
 
-  void setChain(const rosdyn::ChainPtr& chain){chain_ = chain;}
-  void setPoiNames(const std::vector<std::string> poi_names){poi_names_ = poi_names;}
-  void setObstaclesPositions(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions){obstacles_positions_ = obstacles_positions;}
+  void setChain(const rosdyn::ChainPtr& chain)
+  {
+    chain_ = chain;
+    poi_kinematics_.setChain(chain_);
+  }
+  void setPoiNames(const std::vector<std::string> poi_names)
+  {
+    poi_names_ = poi_names;
+    poi_kinematics_.setPoiNames(links_names_,poi_names_);
+  }
+  std::vector<std::string> getPoiNames(){return poi_names_;}
+  void setObstaclesPositions(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions)
+  {
+    obstacles_positions_ = obstacles_positions;
+    obstacles_index_->build(obstacles_positions_);
+
+    if(distance_field_ && update_distance_field_)
+      distance_field_->build(obstacles_positions_);
+  }
+
+  /**
+   * @brief setDistanceField sets the distance field used to pre-filter the pois, skipping those provably farther from the obstacles than the closest one,
+   * nullptr to disable it. The pois that cannot be skipped are still evaluated over all the obstacles.
+   * @param update_distance_field is true if the solver builds the field with its obstacles and updates it when they change.
+   */
+  void setDistanceField(const DistanceFieldPtr& distance_field, const bool& update_distance_field=true)
+  {
+    distance_field_ = distance_field;
+    update_distance_field_ = update_distance_field;
+
+    if(distance_field_ && update_distance_field_)
+      distance_field_->build(obstacles_positions_);
+  }
+  DistanceFieldPtr getDistanceField(){return distance_field_;}
+
+  void setObstaclesIndexThreshold(const unsigned int& threshold){obstacles_index_threshold_ = threshold;}
+  unsigned int getObstaclesIndexThreshold(){return obstacles_index_threshold_;}
 
   Eigen::Matrix<double,3,Eigen::Dynamic> getObstaclesPositions(){return obstacles_positions_;}
 
@@ -82,7 +147,14 @@ public:
   /**
    * @brief clearObstaclePosition clears the matrix of obstacles locations
    */
-  void clearObstaclesPositions(){obstacles_positions_.resize(3,0);}
+  void clearObstaclesPositions()
+  {
+    obstacles_positions_.resize(3,0);
+    obstacles_index_->build(obstacles_positions_);
+
+    if(distance_field_ && update_distance_field_)
+      distance_field_->build(obstacles_positions_);
+  }
 
   /**
    * @brief computeMinDistance: computes the minimum distance between the robot's points of interests (poi) and the obstacles present in the scene.
@@ -91,6 +163,21 @@ public:
    */
   virtual DistancePtr computeMinDistance(const Eigen::VectorXd& q);
 
+  /**
+   * @brief computeMinDistance is the same as above, but it uses the pois positions already computed at q (e.g., by an estimator
+   * which computed them together with the pois velocities), so that the kinematics is not computed again.
+   * @param q: robot configuration
+   * @param poi_positions: positions (columns) of the pois at q, in the order of PoiKinematics::getPoiIdxs.
+   * @return a DistancePtr object containing the minimum distance information.
+   */
+  virtual DistancePtr computeMinDistance(const Eigen::VectorXd& q, const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions);
+
+  /**
+   * @brief computeMinDistance is the same as above, but it fills distance instead of allocating a new object.
+   * @param distance is filled with the minimum distance information.
+   */
+  virtual void computeMinDistance(const Eigen::VectorXd& q, const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions, Distance& distance);
+
   /**
    * @brief clone gives a cloned and indipendent copy of the object
    * @return the cloned object
@@ -0,0 +1,93 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <memory>
+#include <vector>
+#include <eigen3/Eigen/Core>
+
+namespace ssm15066_estimator
+{
+class ObstaclesIndex;
+typedef std::shared_ptr<ObstaclesIndex> ObstaclesIndexPtr;
+
+/**
+ * @brief The ObstaclesIndex class is a static k-d tree over the obstacles positions. It answers nearest-obstacle and within-radius queries
+ * in logarithmic time, so that the cost of the distance computations does not grow linearly with the number of obstacles
+ * (e.g., downsampled depth points). It must be built again every time the obstacles change. Queries are const and thread-safe.
+ */
+class ObstaclesIndex
+{
+protected:
+  /**
+   * @brief points_ is a copy of the indexed obstacles positions.
+   */
+  Eigen::Matrix<double,3,Eigen::Dynamic> points_;
+
+  /**
+   * @brief idxs_ are the obstacles indexes sorted as an implicit k-d tree: the subtree over [begin,end) has its splitting obstacle in
+   * the middle element, split_dims_[middle] is its splitting dimension. Subtrees with at most leaf_size_ elements are scanned linearly.
+   */
+  std::vector<Eigen::Index> idxs_;
+  std::vector<unsigned char> split_dims_;
+
+  static constexpr Eigen::Index leaf_size_ = 8;
+
+  void build(const Eigen::Index& begin, const Eigen::Index& end);
+  void nearest(const Eigen::Index& begin, const Eigen::Index& end, const Eigen::Vector3d& point, Eigen::Index& idx, double& squared_distance) const;
+  void radiusSearch(const Eigen::Index& begin, const Eigen::Index& end, const Eigen::Vector3d& point, const double& squared_radius,
+                    std::vector<Eigen::Index>& idxs) const;
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  ObstaclesIndex(){points_.resize(3,0);}
+  ObstaclesIndex(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions){build(obstacles_positions);}
+
+  /**
+   * @brief build builds the tree over obstacles_positions, discarding the previous ones.
+   */
+  void build(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions);
+
+  Eigen::Index size() const {return points_.cols();}
+
+  /**
+   * @brief nearest finds the obstacle closest to point.
+   * @param point is the query point.
+   * @param distance is filled with the distance of the closest obstacle (infinity if there are no obstacles).
+   * @return the index (column of the obstacles positions matrix) of the closest obstacle, -1 if there are no obstacles.
+   */
+  Eigen::Index nearest(const Eigen::Vector3d& point, double& distance) const;
+
+  /**
+   * @brief radiusSearch finds the obstacles not farther than radius from point.
+   * @param idxs is filled with the indexes of the obstacles found, in ascending order.
+   */
+  void radiusSearch(const Eigen::Vector3d& point, const double& radius, std::vector<Eigen::Index>& idxs) const;
+};
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <memory>
+#include <limits>
+#include <eigen3/Eigen/Core>
+
+namespace ssm15066_estimator
+{
+struct AnytimeEvaluation;
+typedef std::shared_ptr<AnytimeEvaluation> AnytimeEvaluationPtr;
+
+/**
+ * @brief The AnytimeEvaluation struct is the state of the multi-resolution evaluation of a connection (q1,q2), see SSM15066Estimator::startAnytimeEvaluation.
+ * The samples of level l are the 2^l+1 configurations q1+i/2^l*(q2-q1), so each level adds the midpoints of the previous one and the earlier samples
+ * are reused through their sum. The finest level is the first one with a step not longer than the max step size of the estimator.
+ */
+struct AnytimeEvaluation
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  Eigen::VectorXd q1_;
+  Eigen::VectorXd q2_;
+
+  /**
+   * @brief dq_ is the joints velocity used to travel from q1 to q2 (the slowest joint moves at its maximum speed).
+   */
+  Eigen::VectorXd dq_;
+
+  /**
+   * @brief scene_version_ is the scene version of the estimator when the samples were evaluated, they are evaluated again if it changes.
+   */
+  unsigned long scene_version_;
+
+  unsigned int level_;
+  unsigned int max_level_;
+
+  /**
+   * @brief sum_scaling_factor_ is the sum of the scaling factors of the 2^level_+1 samples.
+   */
+  double sum_scaling_factor_;
+
+  /**
+   * @brief scaling_factor_ is the average scaling factor at level_, estimated_error_ is the difference from the one at the previous level
+   * (numeric_limits::max() at level 0, 0.0 if the scaling factor is infinite). It is an estimate, not a bound on the error with respect to
+   * the finest level: a narrow peak of the scaling factor missed by both levels is not detected.
+   */
+  double scaling_factor_;
+  double estimated_error_;
+
+  /**
+   * @brief time_per_sample_ is the evaluation time of a sample measured at the last level (seconds), used to predict the time of the next one.
+   */
+  double time_per_sample_;
+
+  bool isComplete() const
+  {
+    return level_>=max_level_ || scaling_factor_ == std::numeric_limits<double>::infinity();
+  }
+};
+
+}
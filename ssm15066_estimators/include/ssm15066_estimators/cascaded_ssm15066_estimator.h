@@ -0,0 +1,146 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <atomic>
+#include <ssm15066_estimators/parallel_ssm15066_estimator1D.h>
+#include <ssm15066_estimators/parallel_ssm15066_estimator2D.h>
+
+namespace ssm15066_estimator
+{
+class CascadedSSM15066Estimator;
+typedef std::shared_ptr<CascadedSSM15066Estimator> CascadedSSM15066EstimatorPtr;
+
+/**
+  * @brief The CascadedSSM15066Estimator class evaluates a connection with a SSM15066Estimator1D first and with a SSM15066Estimator2D only if needed.
+  * The 1D estimator assumes that each poi moves towards the closest obstacle at the norm of its twist, so its scaling factor is an upper bound of the
+  * 2D one at each sample: if the 1D estimator proves that the robot is never slowed down along the connection, the scaling factor is 1.0 without
+  * running the 2D estimator. The 1D evaluation stops at the first slowed down sample and it skips the samples far from the obstacles
+  * (adaptive sampling with zero tolerance), so it is cheap on the connections the 2D estimator has to evaluate anyway.
+  *
+  * The results are the same of the 2D estimator. The bound holds at the samples of the uniform sampling only, so it is not used if the 2D estimator
+  * integrates the scaling factor with quadrature (its nodes fall between the samples) and the connections are evaluated by the 2D estimator alone.
+  * The 1D estimator is built from the 2D one: the setters of this class change both, and the 1D estimator is built again before the next evaluation
+  * if the 2D one has been changed directly (its scene version changed). If the 2D estimator is a ParallelSSM15066Estimator2D, the 1D estimator is a
+  * ParallelSSM15066Estimator1D with the same threads pool, so the bounds of a batch of connections are evaluated in parallel too.
+  */
+class CascadedSSM15066Estimator: public pathplan::CostPenalty
+{
+protected:
+
+  /**
+   * @brief estimator_ is the 2D estimator, bound_estimator_ is the 1D estimator which bounds it.
+   */
+  SSM15066Estimator2DPtr estimator_;
+  SSM15066Estimator1DPtr bound_estimator_;
+
+  /**
+   * @brief estimator_scene_version_ is the scene version of estimator_ when bound_estimator_ was last updated.
+   */
+  unsigned long estimator_scene_version_;
+
+  /**
+   * @brief connections_ counts the evaluated connections, bound_accepts_ the ones whose scaling factor has been proven to be 1.0 by bound_estimator_.
+   */
+  std::atomic<unsigned long> connections_;
+  std::atomic<unsigned long> bound_accepts_;
+
+  /**
+   * @brief bound_time_ and estimator_time_ are the total times (nanoseconds) spent in bound_estimator_ and in estimator_.
+   */
+  std::atomic<long> bound_time_;
+  std::atomic<long> estimator_time_;
+
+  /**
+   * @brief useBound tells if the bound of bound_estimator_ holds for estimator_, that is if estimator_ evaluates the samples of the uniform sampling.
+   * It updates bound_estimator_ if estimator_ has been changed directly.
+   */
+  bool useBound();
+
+  /**
+   * @brief isBoundedToOne tells if bound_estimator_ proves that the scaling factor of (q1,q2) is 1.0, updating the statistics.
+   */
+  bool isBoundedToOne(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2);
+
+  /**
+   * @brief boundEstimatorUpdated records that estimator_ and bound_estimator_ have been changed the same way.
+   */
+  void boundEstimatorUpdated();
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CascadedSSM15066Estimator(const SSM15066Estimator2DPtr& estimator);
+
+  /**
+   * @brief updateBoundEstimator copies the parameters of estimator_ (chain, step, pois, obstacles and SSM parameters) to bound_estimator_.
+   * It is called automatically when estimator_ has been changed directly.
+   */
+  void updateBoundEstimator();
+
+  SSM15066Estimator2DPtr getEstimator(){return estimator_;}
+  SSM15066Estimator1DPtr getBoundEstimator(){return bound_estimator_;}
+
+  void setPoiNames(const std::vector<std::string> poi_names);
+  void setObstaclesPositions(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions);
+  void addObstaclePosition(const Eigen::Vector3d& obstacle_position);
+  void clearObstaclesPositions();
+  void setObstaclesIndexThreshold(const unsigned int& threshold);
+  void setMaxStepSize(const double& max_step_size);
+  void setMaxCartAcc(const double& max_cart_acc);
+  void setMinDistance(const double& min_distance);
+  void setReactionTime(const double& reaction_time);
+  void setHumanVelocity(const double& human_velocity);
+
+  /**
+   * @brief Statistics of the cascade. getEstimatedSpeedup compares the time spent with the time the 2D estimator alone would have spent,
+   * assuming that the connections accepted by the bound cost as much as the other ones.
+   */
+  unsigned long getConnections(){return connections_;}
+  unsigned long getBoundAccepts(){return bound_accepts_;}
+  double getBoundAcceptRate()
+  {
+    return (connections_>0)? ((double) bound_accepts_)/((double) connections_): 0.0;
+  }
+  double getBoundTime(){return 1e-09*bound_time_;}
+  double getEstimatorTime(){return 1e-09*estimator_time_;}
+  double getEstimatedSpeedup();
+  void resetStatistics();
+
+  virtual void setVerbose(const unsigned int& verbose) override;
+
+  /**
+   * From CostPenaltyClass
+   */
+
+  virtual double computePenalty(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2) override;
+  virtual double computePenaltyBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_penalty) override;
+  virtual std::vector<double> computePenalties(const pathplan::ConfigurationsPairs& connections) override;
+  virtual pathplan::CostPenaltyPtr clone() override;
+};
+
+}
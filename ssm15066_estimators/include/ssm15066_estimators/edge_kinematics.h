@@ -0,0 +1,127 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <eigen3/Eigen/Core>
+#include <penalty_cache.h>
+
+namespace ssm15066_estimator
+{
+struct EdgeKinematics;
+typedef std::shared_ptr<EdgeKinematics> EdgeKinematicsPtr;
+
+class EdgeKinematicsStore;
+typedef std::shared_ptr<EdgeKinematicsStore> EdgeKinematicsStorePtr;
+
+/**
+ * @brief The EdgeKinematics struct collects the kinematics of the robot's points of interest (poi) at each sample of a connection (q1,q2).
+ * These quantities do not depend on the obstacles, so they can be reused to evaluate the connection when the obstacles move.
+ * The data of sample i and poi j is stored in column i*n_pois_+j.
+ */
+struct EdgeKinematics
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  Eigen::VectorXd q1_;
+  Eigen::VectorXd q2_;
+
+  /**
+   * @brief dq_ is the joints velocity used to travel from q1 to q2 (the slowest joint moves at its maximum speed).
+   */
+  Eigen::VectorXd dq_;
+
+  unsigned int n_samples_;
+  unsigned int n_pois_;
+
+  /**
+   * @brief poi_positions_ are the poi positions in base frame.
+   */
+  Eigen::Matrix<double,3,Eigen::Dynamic> poi_positions_;
+
+  /**
+   * @brief poi_velocities_ are the poi linear velocities in base frame.
+   */
+  Eigen::Matrix<double,3,Eigen::Dynamic> poi_velocities_;
+
+  /**
+   * @brief poi_twist_norms_ are the norms of the poi twists (linear and angular part).
+   */
+  Eigen::VectorXd poi_twist_norms_;
+};
+
+/**
+ * @brief The EdgeKinematicsStore class is a bounded least-recently-used store of the EdgeKinematics of a set of connections
+ * (e.g., the connections of a fixed roadmap), indexed by their quantized configurations.
+ */
+class EdgeKinematicsStore
+{
+protected:
+  typedef std::pair<pathplan::ConnectionKey,EdgeKinematicsPtr> Entry;
+
+  /**
+   * @brief capacity_ is the maximum number of stored connections.
+   */
+  size_t capacity_;
+
+  /**
+   * @brief resolution_ is the quantization step of the configurations in the keys.
+   */
+  double resolution_;
+
+  /**
+   * @brief entries_ stores the kinematics from the most to the least recently used, store_ indexes them by key.
+   */
+  std::list<Entry> entries_;
+  std::unordered_map<pathplan::ConnectionKey,std::list<Entry>::iterator,pathplan::ConnectionKeyHash> store_;
+
+  std::mutex mtx_;
+
+public:
+  EdgeKinematicsStore(const size_t& capacity, const double& resolution=1e-06);
+
+  /**
+   * @brief find returns the kinematics of connection (q1,q2), nullptr if not stored.
+   */
+  EdgeKinematicsPtr find(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2);
+
+  /**
+   * @brief insert stores the kinematics of a connection. If the store is full, the least recently used kinematics is evicted.
+   */
+  void insert(const EdgeKinematicsPtr& kinematics);
+  void erase(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2);
+  void clear();
+  size_t size();
+
+  size_t getCapacity(){return capacity_;}
+  double getResolution(){return resolution_;}
+};
+
+}
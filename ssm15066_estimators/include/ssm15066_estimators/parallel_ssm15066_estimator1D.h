@@ -0,0 +1,155 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <ssm15066_estimators/ssm15066_estimator1D.h>
+#include <ssm15066_estimators/sample_scheduler.h>
+
+namespace ssm15066_estimator
+{
+class ParallelSSM15066Estimator1D;
+typedef std::shared_ptr<ParallelSSM15066Estimator1D> ParallelSSM15066Estimator1DPtr;
+
+/**
+  * @brief The ParallelSSM15066Estimator1D class is a multithreads implementation of SSM15066Estimator1D class.
+  * The samples of a connection are spread among the threads by a SampleScheduler, each thread uses its own chain and MinDistanceSolver.
+  * With the kinematics store enabled (see enableKinematicsStore), the threads share the store: the samples of a connection missing from it
+  * are spread among the threads by computeEdgeKinematics, and the batches of connections are spread among the threads as without the store.
+  */
+class ParallelSSM15066Estimator1D: public SSM15066Estimator1D
+{
+protected:
+
+  /**
+   * @brief These are class members related to threads management, chains_, min_distance_solvers_ and workspaces_ are created by initThreadsResources
+   */
+  unsigned int n_threads_;
+  std::vector<rosdyn::ChainPtr> chains_;
+  std::vector<MinDistanceSolverPtr> min_distance_solvers_;
+  std::vector<Workspace> workspaces_;
+
+  /**
+   * @brief scheduler_ spreads the samples among the threads, chains_[i], min_distance_solvers_[i] and workspaces_[i] are used by thread i.
+   */
+  SampleSchedulerPtr scheduler_;
+
+  /**
+   * @brief init intiializes threds-related class members
+   */
+  void init();
+
+  /**
+   * @brief initThreadsResources creates the chains, the solvers and the workspaces of the threads, if not created yet.
+   */
+  void initThreadsResources();
+
+  /**
+   * @brief copySettingsTo copies the thread pool (if shared) and the scheduler settings too, other must be a ParallelSSM15066Estimator1D.
+   */
+  void copySettingsTo(SSM15066Estimator& other) override;
+
+  /**
+   * @brief updatePoiIdxs updates the kinematics frames of min_distance_solvers_ too.
+   */
+  void updatePoiIdxs() override;
+
+  /**
+   * @brief computeScalingFactorParallel computes the average scaling factor along (q1,q2), evaluating its samples in parallel.
+   * @param max_scaling_factor stops the computation as soon as the average is proven to be higher than it (see computeScalingFactorBounded).
+   */
+  double computeScalingFactorParallel(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                                      const double& max_scaling_factor=std::numeric_limits<double>::infinity());
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  ParallelSSM15066Estimator1D(const rosdyn::ChainPtr &chain, const unsigned int& n_threads=std::thread::hardware_concurrency());
+  ParallelSSM15066Estimator1D(const rosdyn::ChainPtr &chain, const double& max_step_size, const unsigned int& n_threads=std::thread::hardware_concurrency());
+  ParallelSSM15066Estimator1D(const rosdyn::ChainPtr &chain, const double& max_step_size,
+                              const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions,
+                              const unsigned int& n_threads=std::thread::hardware_concurrency());
+
+  unsigned int getNumberOfThreads(){return n_threads_;}
+  SampleSchedulerPtr getScheduler(){return scheduler_;}
+
+  /**
+   * @brief setThreadPool makes the estimator use pool (e.g., SampleScheduler::getSharedPool()) instead of its own threads. The clones of the
+   * estimator use the same pool. nullptr restores a pool owned by the estimator.
+   */
+  void setThreadPool(const ThreadPoolPtr& pool);
+  ThreadPoolPtr getThreadPool(){return scheduler_->getThreadPool();}
+
+  void setChunkSize(const unsigned int& chunk_size){scheduler_->setChunkSize(chunk_size);}
+  unsigned int getChunkSize(){return scheduler_->getChunkSize();}
+
+  void setMinSamplesToParallelize(const unsigned int& min_samples){scheduler_->setMinSamplesToParallelize(min_samples);}
+  unsigned int getMinSamplesToParallelize(){return scheduler_->getMinSamplesToParallelize();}
+
+  void addObstaclePosition(const Eigen::Vector3d& obstacle_position) override;
+  void setObstaclesPositions(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions) override;
+  void clearObstaclesPositions() override;
+  void setObstaclesIndexThreshold(const unsigned int& threshold) override;
+  void setDistanceField(const Eigen::Vector3d& min_corner, const Eigen::Vector3d& max_corner, const double& resolution) override;
+  void disableDistanceField() override;
+
+  double computeScalingFactor(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2) override;
+
+  /**
+   * @brief computeScalingFactorBounded is the same as SSM15066Estimator1D::computeScalingFactorBounded, all the threads stop as soon as
+   * the average is proven to be higher than max_scaling_factor.
+   */
+  double computeScalingFactorBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor) override;
+
+  /**
+   * @brief computeScalingFactors evaluates a batch of connections spreading whole connections among the threads.
+   * If the connections are fewer than the threads, each connection is evaluated in parallel by computeScalingFactor.
+   * @param connections is the vector of (q1,q2) pairs.
+   * @return the average scaling factors, in the same order of connections.
+   */
+  std::vector<double> computeScalingFactors(const pathplan::ConfigurationsPairs& connections) override;
+
+  /**
+   * @brief computeEdgeKinematics is the same as SSM15066Estimator::computeEdgeKinematics, the chunks of samples are spread among the threads.
+   */
+  EdgeKinematicsPtr computeEdgeKinematics(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2) override;
+
+  /**
+   * @brief computeScalingFactorsBounded spreads whole connections among the threads as computeScalingFactors, each connection stops as soon as
+   * its average is proven to be higher than max_scaling_factor.
+   */
+  std::vector<double> computeScalingFactorsBounded(const pathplan::ConfigurationsPairs& connections, const double& max_scaling_factor) override;
+
+  /**
+   * @brief computePathScalingFactors evaluates the samples of all the connections of a path at once, spreading them among the threads
+   * (see SampleScheduler::computeAverages). With adaptive sampling, quick accept, quadrature or the kinematics store, the path is evaluated
+   * as a batch of connections.
+   */
+  std::vector<double> computePathScalingFactors(const pathplan::Waypoints& waypoints) override;
+  pathplan::CostPenaltyPtr clone() override;
+};
+
+}
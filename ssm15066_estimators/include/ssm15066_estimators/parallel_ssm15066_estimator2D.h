@@ -28,7 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <Eigen/StdVector>
 #include <ssm15066_estimators/ssm15066_estimator2D.h>
-#include <thread-pool/BS_thread_pool.hpp>  //Credit: Barak Shoshany https://github.com/bshoshany/thread-pool.git
+#include <ssm15066_estimators/sample_scheduler.h>
 
 namespace ssm15066_estimator
 {
@@ -37,78 +37,61 @@ typedef std::shared_ptr<ParallelSSM15066Estimator2D> ParallelSSM15066Estimator2D
 
 /**
   * @brief The ParallelSSM15066Estimator2D class is a multithreads implementation of SSM15066Estimator2D class.
-  * It uses the thread pool of Barak Shoshany (https://github.com/bshoshany/thread-pool.git) to avoid to launch and destroy threads continuously.
+  * It uses the thread pool of Barak Shoshany (https://github.com/bshoshany/thread-pool.git) to avoid to launch and destroy threads continuously,
+  * the samples are spread among the threads by a SampleScheduler.
+  * With the kinematics store enabled (see enableKinematicsStore), the threads share the store: the samples of a connection missing from it
+  * are spread among the threads by computeEdgeKinematics, and the batches of connections are spread among the threads as without the store.
   */
 class ParallelSSM15066Estimator2D: public SSM15066Estimator2D
 {
 protected:
 
   /**
-   * @brief The Queue struct defines an makes more readable the queue struct used by each thread
+   * @brief These are class members related to threads management, chains_ and workspaces_ are created by initThreadsResources
    */
-  struct Queue
-  {
-    std::vector<Eigen::VectorXd, Eigen::aligned_allocator<Eigen::VectorXd> > queue_; //don't remove spaces
-
-    void reset()
-    {
-      queue_.clear();
-      assert(queue_.empty());
-    }
-    void insert(const Eigen::VectorXd& q)
-    {
-      queue_.push_back(q);
-    }
-  };
-  typedef std::shared_ptr<Queue> QueuePtr;
-
-  /**
-   * @brief These are class members related to threads management
-   */
-  bool stop_;
   unsigned int n_threads_;
-  std::vector<QueuePtr> queues_;
-  unsigned int running_threads_;
   std::vector<rosdyn::ChainPtr> chains_;
-  std::vector<std::shared_future<double>> futures_;
+  std::vector<Workspace> workspaces_;
 
-  std::mutex mtx_;
+  /**
+   * @brief scheduler_ spreads the samples among the threads, chains_[i] and workspaces_[i] are used by thread i.
+   */
+  SampleSchedulerPtr scheduler_;
 
   /**
-   * @brief pool_ manages the threads pool.
+   * @brief init intiializes threds-related class members
    */
-  std::shared_ptr<BS::thread_pool> pool_;
+  void init();
 
   /**
-   * @brief dq_max_ is the maximum joint velocity to move from q1 to q2.
+   * @brief initThreadsResources creates the chains and the workspaces of the threads, if not created yet.
    */
-  Eigen::VectorXd dq_max_;
+  void initThreadsResources();
 
   /**
-   * @brief init intiializes threds-related class members
+   * @brief copySettingsTo copies the thread pool (if shared) and the scheduler settings too, other must be a ParallelSSM15066Estimator2D.
    */
-  void init();
+  void copySettingsTo(SSM15066Estimator& other) override;
 
   /**
-   * @brief resetQueues reset queues_
+   * @brief async_chains_ and async_workspaces_ are used by the connections submitted by submitPenalty, async_chains_[i] and async_workspaces_[i]
+   * by the task with slot i (see SampleScheduler::submit). They are created at the first submission.
    */
-  void resetQueues();
+  std::vector<rosdyn::ChainPtr> async_chains_;
+  std::vector<Workspace> async_workspaces_;
 
   /**
-   * @brief fillQueues fill queue_ with the robot configurations q belonging to (q1,q2) to evaluate
-   * @param q1
-   * @param q2
-   * @return the number of q in (q1,q2) to be processed
+   * @brief computePenaltyAsync queues the evaluation of the connection onto the threads pool, each connection is evaluated by a single thread
+   * so that many short connections keep all the threads busy. With the kinematics store, the thread reads or computes its kinematics from the store.
    */
-  unsigned int fillQueues(const Eigen::VectorXd& q1, const Eigen::VectorXd q2);
+  std::future<double> computePenaltyAsync(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const pathplan::PenaltyCallback& callback) override;
 
   /**
-   * @brief computeScalingFactorAsync computes an approximation of the scaling factor the robot will experience at configuration
-   * q, according to SSM ISO-15066. The maximum robot joints' velocities are considered for this computation. It takes q from queue_
-   * @param idx_thread.
-   * @return the sum of scaling factors of each q in queue idx_queue, 0.0 if a q is associated with zero scaling factor.
+   * @brief computeScalingFactorParallel computes the average scaling factor along (q1,q2), evaluating its samples in parallel.
+   * @param max_scaling_factor stops the computation as soon as the average is proven to be higher than it (see computeScalingFactorBounded).
    */
-  double computeScalingFactorAsync(const unsigned int& idx_queue);
+  double computeScalingFactorParallel(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                                      const double& max_scaling_factor=std::numeric_limits<double>::infinity());
 
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -118,8 +101,67 @@ public:
                             const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions,
                             const unsigned int& n_threads=std::thread::hardware_concurrency());
 
+  ~ParallelSSM15066Estimator2D();
+
   unsigned int getNumberOfThreads(){return n_threads_;}
+
+  SampleSchedulerPtr getScheduler(){return scheduler_;}
+
+  /**
+   * @brief setThreadPool makes the estimator use pool (e.g., SampleScheduler::getSharedPool()) instead of its own threads. The clones of the
+   * estimator use the same pool. nullptr restores a pool owned by the estimator. It waits for the connections submitted by submitPenalty.
+   */
+  void setThreadPool(const ThreadPoolPtr& pool);
+  ThreadPoolPtr getThreadPool(){return scheduler_->getThreadPool();}
+
+  void setChunkSize(const unsigned int& chunk_size){scheduler_->setChunkSize(chunk_size);}
+  unsigned int getChunkSize(){return scheduler_->getChunkSize();}
+
+  void setMinSamplesToParallelize(const unsigned int& min_samples){scheduler_->setMinSamplesToParallelize(min_samples);}
+  unsigned int getMinSamplesToParallelize(){return scheduler_->getMinSamplesToParallelize();}
+
+  /**
+   * @brief setMaxPenaltiesInFlight sets the maximum number of connections submitted by submitPenalty and not evaluated yet,
+   * further submissions wait for one of them to complete. It waits for the connections in flight.
+   */
+  void setMaxPenaltiesInFlight(const unsigned int& max_penalties){scheduler_->setMaxTasksInFlight(max_penalties);}
+  unsigned int getMaxPenaltiesInFlight(){return scheduler_->getMaxTasksInFlight();}
+
+  void waitForSubmittedPenalties() override{scheduler_->waitForTasks();}
+
   double computeScalingFactor(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2) override;
+
+  /**
+   * @brief computeScalingFactorBounded is the same as SSM15066Estimator2D::computeScalingFactorBounded, all the threads stop as soon as
+   * the average is proven to be higher than max_scaling_factor.
+   */
+  double computeScalingFactorBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor) override;
+
+  /**
+   * @brief computeScalingFactorBothWays is the same as SSM15066Estimator2D::computeScalingFactorBothWays, the chunks of samples are spread among the threads
+   * and each thread sums the scaling factors of its samples in both directions.
+   */
+  std::pair<double,double> computeScalingFactorBothWays(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2) override;
+
+  /**
+   * @brief computeScalingFactors evaluates a batch of connections spreading whole connections among the threads.
+   * If the connections are fewer than the threads, each connection is evaluated in parallel by computeScalingFactor.
+   * @param connections is the vector of (q1,q2) pairs.
+   * @return the average scaling factors, in the same order of connections.
+   */
+  std::vector<double> computeScalingFactors(const pathplan::ConfigurationsPairs& connections) override;
+
+  /**
+   * @brief computeEdgeKinematics is the same as SSM15066Estimator::computeEdgeKinematics, the chunks of samples are spread among the threads.
+   */
+  EdgeKinematicsPtr computeEdgeKinematics(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2) override;
+
+  /**
+   * @brief computePathScalingFactors evaluates the samples of all the connections of a path at once, spreading them among the threads
+   * (see SampleScheduler::computeAverages). With adaptive sampling, quick accept, quadrature, interpolation or the kinematics store, the path
+   * is evaluated as a batch of connections.
+   */
+  std::vector<double> computePathScalingFactors(const pathplan::Waypoints& waypoints) override;
   pathplan::CostPenaltyPtr clone() override;
 
 };
@@ -0,0 +1,126 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <rosdyn_core/primitives.h>
+
+namespace ssm15066_estimator
+{
+
+/**
+ * @brief The PoiKinematics class computes the kinematics of the robot's points of interest (poi) only. The poi indexes are computed once,
+ * when the pois are set, and the chain outputs are read in place, so neither a names lookup nor a copy of the quantities of all the links is
+ * performed at each configuration. It is the kinematics kernel shared by the estimators and MinDistanceSolver.
+ * When the chain is set (see setChain), the joints axes and the links offsets are read once from the chain, and the pois kinematics is
+ * computed by a single forward recursion over the links, which stops at the deepest poi. Otherwise, the chain computes it at each call.
+ */
+class PoiKinematics
+{
+protected:
+  /**
+   * @brief poi_idxs_ contains the indexes of the pois in the chain links, in ascending order.
+   */
+  std::vector<size_t> poi_idxs_;
+
+  /**
+   * @brief The Link struct describes the i-th link of the chain with respect to its parent (i-1)-th link: its pose at zero configuration
+   * (offset), followed by the motion of its parent joint, if any, along/around axis (in the link frame).
+   */
+  struct Link
+  {
+    Eigen::Matrix3d offset_rotation;
+    Eigen::Vector3d offset_translation;
+    Eigen::Vector3d axis;
+    int joint;
+    bool revolute;
+  };
+
+  /**
+   * @brief base_rotation_ and base_translation_ are the pose of the first link of the chain, links_[i] describes the (i+1)-th link.
+   * links_ is empty if the chain has not been set.
+   */
+  Eigen::Matrix3d base_rotation_;
+  Eigen::Vector3d base_translation_;
+  std::vector<Link> links_;
+
+  /**
+   * @brief computeForwardRecursion computes the pois positions, and their velocities and twist norms when not null, from the base to the deepest poi.
+   */
+  void computeForwardRecursion(const Eigen::VectorXd& q, const Eigen::VectorXd* dq,
+                               Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_positions,
+                               Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>>* poi_velocities,
+                               Eigen::Ref<Eigen::VectorXd>* poi_twist_norms) const;
+
+public:
+  PoiKinematics(){}
+  PoiKinematics(const std::vector<std::string>& links_names, const std::vector<std::string>& poi_names){setPoiNames(links_names,poi_names);}
+
+  /**
+   * @brief setPoiNames selects the pois among the chain links.
+   * @param links_names are the names of all the links of the chain (see rosdyn::Chain::getLinksName).
+   * @param poi_names are the names of the pois, links not in the chain are ignored.
+   */
+  void setPoiNames(const std::vector<std::string>& links_names, const std::vector<std::string>& poi_names);
+
+  /**
+   * @brief setChain reads the links offsets and the joints axes of a serial chain, perturbing one joint at a time from the zero configuration.
+   * @param chain is the chain whose links are the ones of setPoiNames. Its clones share the same geometry, so any of them can be passed
+   * to the compute functions afterwards.
+   */
+  void setChain(const rosdyn::ChainPtr& chain);
+
+  const std::vector<size_t>& getPoiIdxs() const {return poi_idxs_;}
+  size_t getPoisNumber() const {return poi_idxs_.size();}
+
+  /**
+   * @brief computePositions computes the pois positions at configuration q.
+   * @param chain is the chain used for the computations if setChain has not been called.
+   * @param poi_positions is filled with the pois positions (columns) in base frame, it must have getPoisNumber() columns.
+   */
+  void computePositions(const rosdyn::ChainPtr& chain, const Eigen::VectorXd& q,
+                        Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_positions) const;
+
+  /**
+   * @brief computePositionsAndVelocities computes the pois positions and linear velocities at configuration q, moving with velocity dq.
+   * @param poi_velocities is filled with the pois linear velocities (columns) in base frame, it must have getPoisNumber() columns.
+   */
+  void computePositionsAndVelocities(const rosdyn::ChainPtr& chain, const Eigen::VectorXd& q, const Eigen::VectorXd& dq,
+                                     Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_positions,
+                                     Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_velocities) const;
+
+  /**
+   * @brief computePositionsAndVelocities is the same as above, it also computes the norms of the pois twists (linear and angular velocity).
+   * @param poi_twist_norms is filled with the norms of the pois twists, it must have getPoisNumber() elements.
+   */
+  void computePositionsAndVelocities(const rosdyn::ChainPtr& chain, const Eigen::VectorXd& q, const Eigen::VectorXd& dq,
+                                     Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_positions,
+                                     Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_velocities,
+                                     Eigen::Ref<Eigen::VectorXd> poi_twist_norms) const;
+};
+
+}
@@ -0,0 +1,293 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <ros/ros.h>
+#include <thread-pool/BS_thread_pool.hpp>  //Credit: Barak Shoshany https://github.com/bshoshany/thread-pool.git
+
+namespace ssm15066_estimator
+{
+class SampleScheduler;
+typedef std::shared_ptr<SampleScheduler> SampleSchedulerPtr;
+typedef std::shared_ptr<BS::thread_pool> ThreadPoolPtr;
+
+/**
+ * @brief The SampleScheduler class spreads the evaluation of the samples of a connection (or of a batch of connections) among a pool of threads.
+ * The samples are grouped in chunks of consecutive indexes, taken by the threads from a shared counter, so that faster threads take more chunks.
+ * The calling thread evaluates chunks too and it waits only for the tasks it submitted. Short connections are evaluated by the calling thread only.
+ * The evaluation is defined by a function of the thread index (to use per-thread resources, e.g. chains) and of the sample index.
+ * The pool can be shared by many schedulers (see getSharedPool), e.g. by the estimators cloned for each planning thread, so that the machine
+ * is not oversubscribed: the thread indexes refer to the tasks of the scheduler, not to the threads of the pool, and each scheduler waits only
+ * for its own tasks. A scheduler owning its pool creates it at the first parallel evaluation.
+ */
+class SampleScheduler
+{
+public:
+  /**
+   * @brief SampleFunction computes the scaling factor of sample (second argument) using the resources of thread (first argument).
+   */
+  typedef std::function<double(const unsigned int&, const unsigned int&)> SampleFunction;
+
+  /**
+   * @brief ItemFunction processes item (second argument) using the resources of thread (first argument).
+   */
+  typedef std::function<void(const unsigned int&, const size_t&)> ItemFunction;
+
+  /**
+   * @brief GroupSampleFunction computes the scaling factor of a sample (third argument) of a group of samples (second argument, e.g. a connection
+   * of a path) using the resources of thread (first argument).
+   */
+  typedef std::function<double(const unsigned int&, const size_t&, const unsigned int&)> GroupSampleFunction;
+
+  /**
+   * @brief TaskFunction computes a value (e.g., the scaling factor of a whole connection) using the resources of a slot (argument) in [0,getMaxTasksInFlight()).
+   * No other task in flight uses the same slot.
+   */
+  typedef std::function<double(const unsigned int&)> TaskFunction;
+
+protected:
+  /**
+   * @brief The SampleBatch struct is the state shared by the tasks evaluating the samples of a connection. It is held by a shared pointer,
+   * so that the tasks still queued in the pool when computeAverage returns (e.g., after an infinite scaling factor) find it valid.
+   * Those tasks see the batch stopped and return without calling sample_function.
+   */
+  struct SampleBatch
+  {
+    /**
+     * @brief stop is the cancellation token, checked before each sample. It is set as soon as a sample has an infinite scaling factor
+     * or the average is proven to be higher than max_average.
+     */
+    std::atomic<bool> stop;
+    std::atomic<unsigned int> next_chunk;
+
+    unsigned int n_samples;
+    unsigned int n_chunks;
+    unsigned int chunk_size;
+    double max_average;
+    const SampleFunction* sample_function;
+
+    /**
+     * @brief These members are protected by mtx. running is the number of tasks evaluating samples,
+     * excess is the sum of (scaling factor - 1.0) over the evaluated chunks.
+     */
+    std::mutex mtx;
+    std::condition_variable cv;
+    unsigned int running;
+    double sum;
+    double excess;
+    bool infinite;
+    bool bound_exceeded;
+  };
+  typedef std::shared_ptr<SampleBatch> SampleBatchPtr;
+
+  /**
+   * @brief The ItemBatch struct is the state shared by the tasks of forEach. As for SampleBatch, the tasks still queued when forEach returns
+   * find it exhausted and return without calling item_function.
+   */
+  struct ItemBatch
+  {
+    std::atomic<size_t> next_item;
+    size_t n_items;
+    const ItemFunction* item_function;
+
+    /**
+     * @brief running is the number of tasks processing items, protected by mtx.
+     */
+    std::mutex mtx;
+    std::condition_variable cv;
+    unsigned int running;
+  };
+  typedef std::shared_ptr<ItemBatch> ItemBatchPtr;
+
+  /**
+   * @brief batch_ is reused by the next computeAverage call, unless some task of a stopped call still refers to it.
+   */
+  SampleBatchPtr batch_;
+
+  unsigned int n_threads_;
+
+  /**
+   * @brief pool_ manages the threads pool, nullptr until the first parallel evaluation if the scheduler owns it.
+   * shared_pool_ is true if the pool has been given to the constructor.
+   */
+  ThreadPoolPtr pool_;
+  bool shared_pool_;
+
+  /**
+   * @brief getPool returns pool_, creating it if needed.
+   */
+  BS::thread_pool& getPool();
+
+  /**
+   * @brief chunk_size_ is the number of consecutive samples evaluated by a thread at a time.
+   */
+  unsigned int chunk_size_;
+
+  /**
+   * @brief min_samples_to_parallelize_ is the minimum number of samples to evaluate them in parallel, fewer samples are evaluated by the calling thread,
+   * since the threads synchronization would cost more than it saves.
+   */
+  unsigned int min_samples_to_parallelize_;
+
+  /**
+   * @brief max_tasks_in_flight_ is the maximum number of tasks submitted by submit and not completed yet. free_slots_ are the slots
+   * not used by a task in flight, protected by tasks_mtx_.
+   */
+  unsigned int max_tasks_in_flight_;
+  std::vector<unsigned int> free_slots_;
+  std::mutex tasks_mtx_;
+  std::condition_variable tasks_cv_;
+
+  /**
+   * @brief releaseSlot makes slot available to the next submitted task.
+   */
+  void releaseSlot(const unsigned int& slot);
+
+  /**
+   * @brief computeSumOfChunks evaluates chunks of samples until all of them have been taken or the batch is stopped.
+   * @param thread is the index of the thread, passed to the sample function.
+   * @param batch is the shared state of the samples evaluation.
+   * @return the sum of the scaling factors of the samples evaluated by the thread, infinity if a sample has an infinite scaling factor.
+   */
+  static double computeSumOfChunks(const unsigned int& thread, SampleBatch& batch);
+
+  /**
+   * @brief runTask is the task executed by the pool threads. It evaluates chunks only if the batch is neither stopped nor exhausted when it starts,
+   * and it accumulates its sum into the batch.
+   */
+  static void runTask(const unsigned int& thread, const SampleBatchPtr& batch);
+
+  /**
+   * @brief runItemsTask is the task of forEach executed by the pool threads. It processes items only if the batch is not exhausted when it starts.
+   */
+  static void runItemsTask(const unsigned int& thread, const ItemBatchPtr& batch);
+
+public:
+  /**
+   * @brief SampleScheduler
+   * @param n_threads is the number of threads, including the calling one. It is limited to the hardware concurrency.
+   * @param pool is the threads pool to use, possibly shared with other schedulers. If nullptr, the scheduler creates its own pool with n_threads threads.
+   */
+  SampleScheduler(const unsigned int& n_threads=std::thread::hardware_concurrency(), const ThreadPoolPtr& pool=nullptr);
+
+  ~SampleScheduler();
+
+  unsigned int getNumberOfThreads(){return n_threads_;}
+
+  /**
+   * @brief getSharedPool returns the process-wide threads pool, with as many threads as the hardware concurrency. It is created at the first call.
+   */
+  static ThreadPoolPtr getSharedPool();
+
+  /**
+   * @brief getThreadPool returns the pool given to the constructor, nullptr if the scheduler owns its pool.
+   */
+  ThreadPoolPtr getThreadPool(){return shared_pool_? pool_: nullptr;}
+
+  /**
+   * @brief getUsedPool returns the pool used by the scheduler, given to the constructor or owned (created if needed), e.g. to run other batches on
+   * the same threads. It must be called by the thread calling the scheduler.
+   */
+  ThreadPoolPtr getUsedPool()
+  {
+    getPool();
+    return pool_;
+  }
+
+  void setChunkSize(const unsigned int& chunk_size){chunk_size_ = std::max(chunk_size,1u);}
+  unsigned int getChunkSize(){return chunk_size_;}
+
+  void setMinSamplesToParallelize(const unsigned int& min_samples){min_samples_to_parallelize_ = min_samples;}
+  unsigned int getMinSamplesToParallelize(){return min_samples_to_parallelize_;}
+
+  /**
+   * @brief setMaxTasksInFlight sets the maximum number of tasks submitted by submit and not completed yet (2 per thread by default).
+   * It waits for the tasks in flight.
+   */
+  void setMaxTasksInFlight(const unsigned int& max_tasks);
+  unsigned int getMaxTasksInFlight(){return max_tasks_in_flight_;}
+
+  /**
+   * @brief getTasksInFlight returns the number of tasks submitted by submit and not completed yet.
+   */
+  unsigned int getTasksInFlight();
+
+  /**
+   * @brief isParallel tells if n_samples samples are evaluated in parallel.
+   */
+  bool isParallel(const unsigned int& n_samples){return (n_threads_>1 && n_samples>=min_samples_to_parallelize_);}
+
+  /**
+   * @brief computeAverage computes the average of the scaling factors of the samples [0,n_samples).
+   * @param n_samples is the number of samples.
+   * @param sample_function computes the scaling factor of a sample, it is called concurrently with thread in [0,getNumberOfThreads()).
+   * @param max_average stops the computation as soon as the average is proven to be higher than it, the samples not evaluated are counted as 1.0.
+   * When a sample has an infinite scaling factor, the other threads stop at their next sample and the function returns without waiting for the queued tasks.
+   * @return the average scaling factor, infinity if a sample has an infinite scaling factor, a lower bound of the average higher than max_average
+   * if the computation has been stopped.
+   */
+  double computeAverage(const unsigned int& n_samples, const SampleFunction& sample_function,
+                        const double& max_average=std::numeric_limits<double>::infinity());
+
+  /**
+   * @brief forEach calls item_function on the items [0,n_items), taken one at a time by the threads. It returns when all the items have been
+   * processed, without waiting for the tasks still queued in the pool (e.g., behind the tasks of other estimators sharing it).
+   * @param n_items is the number of items.
+   * @param item_function processes an item, it is called concurrently with thread in [0,getNumberOfThreads()).
+   */
+  void forEach(const size_t& n_items, const ItemFunction& item_function);
+
+  /**
+   * @brief computeAverages computes the average scaling factor of each group of samples, spreading the samples of all the groups among the threads
+   * at once: the samples are numbered consecutively across the groups and taken in chunks, so that many short groups are balanced as a long one.
+   * @param n_samples is the number of samples of each group (a group without samples has average 1.0).
+   * @param sample_function computes the scaling factor of a sample of a group, it is called concurrently with thread in [0,getNumberOfThreads()).
+   * @return the average scaling factor of each group, infinity if a sample of the group has an infinite scaling factor.
+   */
+  std::vector<double> computeAverages(const std::vector<unsigned int>& n_samples, const GroupSampleFunction& sample_function);
+
+  /**
+   * @brief submit queues task onto the threads pool and returns without waiting for it. If getMaxTasksInFlight() tasks are already in flight,
+   * the caller is blocked until one of them completes, so that the queue of the pool stays bounded.
+   * It must not be called by a task of the pool, which could wait for itself.
+   * @param task computes the value, it is called by a thread of the pool with a free slot.
+   * @return the future value, it reports the exception thrown by task, if any.
+   */
+  std::future<double> submit(const TaskFunction& task);
+
+  /**
+   * @brief waitForTasks waits until all the tasks submitted by submit have been completed.
+   */
+  void waitForTasks();
+};
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <vector>
+#include <string>
+#include <eigen3/Eigen/Core>
+
+namespace ssm15066_estimator
+{
+
+/**
+ * @brief The ScalingFactorKernel class computes the maximum scaling factor of the 2D estimators over all the obstacle-poi pairs at a configuration.
+ * The obstacles are stored as structure of arrays, padded to a multiple of the vector width with far away points, and for each poi the
+ * obstacles are processed in vector registers (AVX2 or AVX-512, selected at runtime, with a scalar fallback). Only the pairs where the poi
+ * moves towards the obstacle and is within the influence distance of its speed (checked on squared distances) can slow the robot down,
+ * so the square roots are computed for them only.
+ */
+class ScalingFactorKernel
+{
+public:
+  enum class InstructionSet {SCALAR, AVX2, AVX512};
+
+protected:
+  /**
+   * @brief obstacles_x_, obstacles_y_, obstacles_z_ are the obstacles coordinates, padded to a multiple of 8 elements.
+   */
+  std::vector<double> obstacles_x_;
+  std::vector<double> obstacles_y_;
+  std::vector<double> obstacles_z_;
+
+  size_t n_obstacles_;
+
+  InstructionSet instruction_set_;
+
+public:
+  ScalingFactorKernel();
+
+  /**
+   * @brief setObstacles stores the obstacles positions (columns).
+   */
+  void setObstacles(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions);
+
+  size_t getObstaclesNumber() const {return n_obstacles_;}
+
+  /**
+   * @brief setInstructionSet selects the instruction set of the kernel. If it is not supported by the cpu, the best supported one is used.
+   */
+  void setInstructionSet(const InstructionSet& instruction_set);
+  InstructionSet getInstructionSet() const {return instruction_set_;}
+
+  /**
+   * @brief getBestInstructionSet returns the best instruction set supported by the cpu.
+   */
+  static InstructionSet getBestInstructionSet();
+  static std::string toString(const InstructionSet& instruction_set);
+
+  /**
+   * @brief computeMaxScalingFactor computes the maximum scaling factor over all the obstacle-poi pairs, see SSM15066Estimator2D::computeScalingFactorAtPois.
+   * @param poi_positions are the pois positions (columns) in base frame.
+   * @param poi_velocities are the pois linear velocities (columns) in base frame.
+   * @param min_distance, max_cart_acc, term1 and term2 are the parameters of the SSM equation (see SSM15066Estimator).
+   * @return the maximum scaling factor (>=1.0), infinity if the robot must stop.
+   */
+  double computeMaxScalingFactor(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                 const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                                 const double& min_distance, const double& max_cart_acc, const double& term1, const double& term2) const;
+};
+
+}
@@ -26,10 +26,18 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <atomic>
 #include <ros/ros.h>
 #include <eigen3/Eigen/Core>
 #include <rosdyn_core/primitives.h>
 #include <length_penalty_metrics.h>
+#include <ssm15066_estimators/edge_kinematics.h>
+#include <ssm15066_estimators/anytime_evaluation.h>
+#include <ssm15066_estimators/poi_kinematics.h>
+#include <ssm15066_estimators/scaling_factor_kernel.h>
+#include <ssm15066_estimators/workspace.h>
+#include <min_distance_solvers/obstacles_index.h>
+#include <min_distance_solvers/distance_field.h>
 
 namespace ssm15066_estimator
 {
@@ -69,11 +77,78 @@ protected:
    */
   std::vector<std::string> frames_names_;
 
+  /**
+   * @brief poi_idxs_ contains the indexes of the points of interest in frames_names_ (and so in the outputs of the chain kinematics), in ascending order.
+   */
+  std::vector<size_t> poi_idxs_;
+
+  /**
+   * @brief poi_kinematics_ computes the kinematics of the pois only.
+   */
+  PoiKinematics poi_kinematics_;
+
+  /**
+   * @brief kinematics_store_ stores the kinematics of the connections already evaluated, nullptr if disabled.
+   */
+  EdgeKinematicsStorePtr kinematics_store_;
+
+  /**
+   * @brief poi_levers_ bounds the pois linear velocities as ||v_poi_i|| <= poi_levers_.row(i)*|dq|. Element (i,j) is the length of the robot chain
+   * from joint j to poi i (zero if joint j does not move poi i), an upper bound of the poi distance from the joint axis.
+   */
+  Eigen::MatrixXd poi_levers_;
+
+  /**
+   * @brief adaptive_sampling_ enables the adaptive sampling of the connections, see setAdaptiveSampling.
+   */
+  bool adaptive_sampling_;
+  double adaptive_sampling_tolerance_;
+
+  /**
+   * @brief quick_accept_ enables the check of isFarFromObstacles before sampling a connection, see setQuickAccept.
+   * quick_accept_checks_ counts the checked connections and quick_accepts_ the ones accepted without sampling.
+   */
+  bool quick_accept_;
+  std::atomic<unsigned long> quick_accept_checks_;
+  std::atomic<unsigned long> quick_accepts_;
+
+  /**
+   * @brief quadrature_ enables the integration of the scaling factor with an adaptive quadrature, see setQuadrature.
+   */
+  bool quadrature_;
+  double quadrature_absolute_tolerance_;
+  double quadrature_relative_tolerance_;
+
   /**
    * @brief obstacles_positions_: matrix containing obstacles positions. x,y,z (rows) of obstacles (cols). Number of cols depends on the number of obstacles present in the scene.
    */
   Eigen::Matrix <double,3,Eigen::Dynamic> obstacles_positions_;
 
+  /**
+   * @brief obstacles_index_ is a k-d tree over obstacles_positions_, rebuilt every time the obstacles change.
+   */
+  ObstaclesIndexPtr obstacles_index_;
+
+  /**
+   * @brief obstacles_index_threshold_ is the minimum number of obstacles to use obstacles_index_, below it a linear scan is faster.
+   */
+  unsigned int obstacles_index_threshold_;
+
+  /**
+   * @brief scaling_factor_kernel_ stores the obstacles as structure of arrays and computes the 2D scaling factor in vector registers.
+   */
+  ScalingFactorKernel scaling_factor_kernel_;
+
+  /**
+   * @brief distance_field_ stores the distance from the closest obstacle over the workcell, used as pre-filter of the pois, nullptr if disabled (see setDistanceField).
+   */
+  DistanceFieldPtr distance_field_;
+
+  /**
+   * @brief workspace_ holds the buffers used by the sequential evaluation of the connections, see Workspace.
+   */
+  Workspace workspace_;
+
   /**
    * @brief inv_max_speed_ is the inverse of the max joints speed.
    */
@@ -119,6 +194,168 @@ protected:
    */
   unsigned int verbose_;
 
+  /**
+   * @brief updateObstaclesIndexes rebuilds obstacles_index_, the obstacles of scaling_factor_kernel_ and distance_field_ from obstacles_positions_.
+   * @param update_distance_field is false if distance_field_ has already been updated (e.g., incrementally).
+   */
+  void updateObstaclesIndexes(const bool& update_distance_field=true)
+  {
+    obstacles_index_->build(obstacles_positions_);
+    scaling_factor_kernel_.setObstacles(obstacles_positions_);
+
+    if(distance_field_ && update_distance_field)
+      distance_field_->build(obstacles_positions_);
+  }
+
+  /**
+   * @brief updatePoiIdxs updates poi_idxs_, poi_kinematics_ and poi_levers_ from poi_names_.
+   */
+  virtual void updatePoiIdxs();
+
+  /**
+   * @brief updatePoiLevers computes poi_levers_. The joint moved by each joint is found perturbing it, the lengths of the chain are measured
+   * between consecutive frames (constant for revolute joints). A prismatic joint contributes with its own speed.
+   */
+  void updatePoiLevers();
+
+  /**
+   * @brief computePoiKinematics computes the pois positions and linear velocities at configuration q, moving with velocity dq.
+   * @param chain is the chain used for the kinematics computations.
+   * @param poi_positions is filled with the pois positions (columns) in base frame.
+   * @param poi_velocities is filled with the pois linear velocities (columns) in base frame.
+   */
+  void computePoiKinematics(const rosdyn::ChainPtr& chain, const Eigen::VectorXd& q, const Eigen::VectorXd& dq,
+                            Eigen::Matrix<double,3,Eigen::Dynamic>& poi_positions, Eigen::Matrix<double,3,Eigen::Dynamic>& poi_velocities);
+
+  /**
+   * @brief computeSamplesToSkip computes how many samples after the current one have a scaling factor not higher than 1+adaptive_sampling_tolerance_ for sure.
+   * The pois velocities are bounded using poi_levers_, then it is checked how many samples each poi stays farther from the obstacles than
+   * the distance at which the safe velocity is higher than its velocity bound (scaled by 1+adaptive_sampling_tolerance_).
+   * This version checks each poi against its own distance from the obstacles (2D estimators).
+   * @param poi_positions are the pois positions at the current sample.
+   * @param dq is the joint velocity along the connection.
+   * @param delta_q is the joint displacement between consecutive samples.
+   * @return the number of samples that can be skipped.
+   */
+  unsigned int computeSamplesToSkip(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                    const Eigen::VectorXd& dq, const Eigen::VectorXd& delta_q);
+
+  /**
+   * @brief computeSamplesToSkip is the same as above, but it considers the minimum human-robot distance for all the pois and bounds
+   * the norm of the pois twists (1D estimators).
+   * @param min_distance is the minimum human-robot distance at the current sample.
+   */
+  unsigned int computeSamplesToSkip(const double& min_distance, const Eigen::VectorXd& dq, const Eigen::VectorXd& delta_q);
+
+  /**
+   * @brief computeDistanceFromObstacles computes the distance of position from the closest obstacle (numeric_limits::max() if there are no obstacles).
+   */
+  double computeDistanceFromObstacles(const Eigen::Ref<const Eigen::Vector3d>& position);
+
+  /**
+   * @brief isFarFromObstacles tells if the scaling factor is 1.0 at every sample of the connection (q1,q2) for sure, without sampling it.
+   * The pois speeds are bounded using poi_levers_ and poi i travels at most poi_levers_.row(i)*|q2-q1| along the connection, so it never gets closer
+   * to the obstacles than (d(q1)+d(q2)-travel)/2, where d(q1) and d(q2) are its distances at the endpoints. The connection is accepted if this bound is
+   * higher than the distance at which the safe velocity exceeds the speed bound, for every poi. Only the pois positions at q1 and q2 are computed.
+   * @param twist_speeds is true if the norms of the pois twists are compared with the minimum distance of all the pois (1D estimators).
+   * @return true if the scaling factor of the connection is 1.0.
+   */
+  bool isFarFromObstacles(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                          const bool& twist_speeds);
+
+  /**
+   * @brief kronrod_nodes_, kronrod_weights_ and gauss_weights_ are the Gauss-Kronrod 7-15 points rule on [-1,1], the odd Kronrod nodes are the Gauss nodes.
+   */
+  static const double kronrod_nodes_[8];
+  static const double kronrod_weights_[8];
+  static const double gauss_weights_[4];
+
+  /**
+   * @brief integrateScalingFactor computes the average scaling factor along (q1,q2) as the integral of scaling_factor_of_q over the connection,
+   * using an adaptive Gauss-Kronrod quadrature (see setQuadrature). If a sample of the uniform sampling may have an infinite scaling factor
+   * (see mayHaveInfiniteSample), the connection is sampled uniformly as without quadrature, so that a narrow region with an infinite scaling factor
+   * between the Kronrod nodes is not missed. workspace.dq is set to the joints velocity along the connection and workspace.q to the evaluated configurations.
+   * @param scaling_factor_of_q is a functor computing the scaling factor of a configuration, moving with velocity workspace.dq.
+   * @param max_scaling_factor stops the computation as soon as the average is proven to be higher than it (see computeScalingFactorBounded).
+   * @return the average scaling factor.
+   */
+  template<typename ScalingFactorFunction>
+  double integrateScalingFactor(const ScalingFactorFunction& scaling_factor_of_q, const rosdyn::ChainPtr& chain, Workspace& workspace,
+                                const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor);
+
+  /**
+   * @brief integrateScalingFactorOnInterval integrates the scaling factor over the fraction [a,b] of the connection q1+s*workspace.connection_vector,
+   * splitting it until the Kronrod and Gauss estimates agree. An interval with an infinite scaling factor at any node, or too short to be split
+   * with fewer evaluations than the uniform sampling, is sampled uniformly with step max_step_size_.
+   * @param length is the length of the connection.
+   * @param integral_before is the integral over [0,a], to stop as soon as the average is proven to be higher than max_scaling_factor.
+   * @return the integral over [a,b], infinite if any sample has an infinite scaling factor.
+   */
+  template<typename ScalingFactorFunction>
+  double integrateScalingFactorOnInterval(const ScalingFactorFunction& scaling_factor_of_q, Workspace& workspace, const Eigen::VectorXd& q1,
+                                          const double& length, const double& a, const double& b, const double& integral_before,
+                                          const double& max_scaling_factor);
+
+  /**
+   * @brief sampleScalingFactorOnInterval integrates the scaling factor over the fraction [a,b] of the connection sampling it uniformly with iter steps.
+   * @return the integral over [a,b], infinite if any sample has an infinite scaling factor.
+   */
+  template<typename ScalingFactorFunction>
+  double sampleScalingFactorOnInterval(const ScalingFactorFunction& scaling_factor_of_q, Workspace& workspace, const Eigen::VectorXd& q1,
+                                       const double& a, const double& b, const unsigned int& iter, const double& integral_before,
+                                       const double& max_scaling_factor);
+
+  /**
+   * @brief mayHaveInfiniteSample checks the iter+1 uniform samples of the connection q1+s*workspace.connection_vector for an infinite scaling factor,
+   * computing the pois positions only. The scaling factor can be infinite only if a poi is closer to an obstacle than computeInfluenceDistance(0.0),
+   * so the samples where every poi stays provably farther (bounding their travel with poi_levers_) are skipped. workspace.delta_q is set to the step.
+   * @return true if a sample may have an infinite scaling factor.
+   */
+  bool mayHaveInfiniteSample(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const unsigned int& iter);
+
+  /**
+   * @brief computeScalingFactorOfSample computes the scaling factor of configuration q, moving with velocity dq, as the samples of computeScalingFactor.
+   */
+  virtual double computeScalingFactorOfSample(const Eigen::VectorXd& q, const Eigen::VectorXd& dq) = 0;
+
+  /**
+   * @brief increaseAnytimeLevel evaluates the samples of the next level of evaluation, see AnytimeEvaluation. If the scene has changed since
+   * the evaluation of the previous samples, it evaluates the first level again.
+   */
+  void increaseAnytimeLevel(AnytimeEvaluation& evaluation);
+
+  /**
+   * @brief computePathSampling computes the uniform sampling of each connection of a path, as computeScalingFactor: sample i of connection j is
+   * waypoints[j]+i*delta_qs[j], moving with velocity dqs[j]. Coincident waypoints have no samples.
+   * @param n_samples is filled with the number of samples of each connection.
+   */
+  void computePathSampling(const pathplan::Waypoints& waypoints, std::vector<Eigen::VectorXd>& dqs, std::vector<Eigen::VectorXd>& delta_qs,
+                           std::vector<unsigned int>& n_samples);
+
+  /**
+   * @brief getEdgeKinematics returns the kinematics of connection (q1,q2) from kinematics_store_, computing and storing it with computeEdgeKinematics
+   * if not present. kinematics_store_ is thread-safe: the threads of the parallel estimators call the overload with their own chain and workspace.
+   */
+  EdgeKinematicsPtr getEdgeKinematics(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2);
+  EdgeKinematicsPtr getEdgeKinematics(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2);
+
+  /**
+   * @brief createEdgeKinematics creates the kinematics of connection (q1,q2), with the same sampling of the estimators, without computing its samples.
+   */
+  EdgeKinematicsPtr createEdgeKinematics(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2);
+
+  /**
+   * @brief computeEdgeKinematicsSamples computes the pois kinematics at the samples [first,last) of kinematics, using chain and the buffers of workspace.
+   */
+  void computeEdgeKinematicsSamples(const rosdyn::ChainPtr& chain, Workspace& workspace, EdgeKinematics& kinematics,
+                                    const unsigned int& first, const unsigned int& last);
+
+  /**
+   * @brief copySettingsTo copies the parameters and the settings of the estimator to other (e.g., a clone), except verbosity.
+   * other gets its own distance field, with the same workcell and resolution, and its own empty kinematics store. Override it to copy the settings of a derived class.
+   */
+  virtual void copySettingsTo(SSM15066Estimator& other);
+
   /**
    * @brief safeVelocity applies the SSM equation to compute the maximum robot cartesian velocity given the minimum human-robot distance as input
    * @param distance is the minimum human-robot distance
@@ -146,46 +383,160 @@ public:
 
   /**
    * @brief Change a class member using the following functions. By defaults, term1_ and term2_ are updated
-   * everytime you modify a class member. If you need to change multiple members and you don't want to call
+   * everytime you modify a class member. updateMembers() also increases the scene version, invalidating cached penalties. If you need to change multiple members and you don't want to call
    * updateMembers() everytime set update = false in each function and call updateMembers() at the end.
+   * The setters wait for the connections submitted by submitPenalty and not evaluated yet, since they read the class members (see waitForSubmittedPenalties).
    */
   void updateMembers();
   void setMaxCartAcc(const double& max_cart_acc, const bool update = true)
   {
+    waitForSubmittedPenalties();
+
     max_cart_acc_ = max_cart_acc;
     if(update)
       updateMembers();
   }
   void setMinDistance(const double& min_distance, const bool update = true)
   {
+    waitForSubmittedPenalties();
+
     min_distance_ = min_distance;
     if(update)
       updateMembers();
   }
   void setReactionTime(const double& reaction_time, const bool update = true)
   {
+    waitForSubmittedPenalties();
+
     reaction_time_ = reaction_time;
     if(update)
       updateMembers();
   }
   void setHumanVelocity(const double& human_velocity, const bool update = true)
   {
+    waitForSubmittedPenalties();
+
     human_velocity_ = human_velocity;
     if(update)
       updateMembers();
   }
-  void setPoiNames(const std::vector<std::string> poi_names)
+  virtual void setPoiNames(const std::vector<std::string> poi_names)
   {
+    waitForSubmittedPenalties();
+
     if(poi_names.empty())
     {
       ROS_ERROR("Poi names void");
       return;
     }
     poi_names_ = poi_names;
+    updatePoiIdxs();
+
+    if(kinematics_store_)
+      kinematics_store_->clear();
+
+    increaseSceneVersion();
   }
 
   void setMaxStepSize(const double& max_step_size);
-  void setVerbose(const unsigned int& verbose){verbose_ = verbose;}
+  void setVerbose(const unsigned int& verbose)
+  {
+    waitForSubmittedPenalties();
+    verbose_ = verbose;
+  }
+
+  /**
+   * @brief setAdaptiveSampling enables the adaptive sampling of the connections. The samples where the robot is provably far enough from the
+   * obstacles to have a scaling factor not higher than 1+tolerance are skipped and counted as 1.0, so the result differs from the uniform sampling
+   * at most by tolerance. Samples are evaluated densely only near the obstacles.
+   * @param adaptive_sampling enables/disables the adaptive sampling.
+   * @param tolerance is the maximum allowed difference from the uniform sampling result (>=0).
+   */
+  void setAdaptiveSampling(const bool& adaptive_sampling, const double& tolerance=0.0)
+  {
+    waitForSubmittedPenalties();
+
+    adaptive_sampling_ = adaptive_sampling;
+    adaptive_sampling_tolerance_ = std::max(tolerance,0.0);
+    increaseSceneVersion();
+  }
+
+  /**
+   * @brief setQuickAccept enables a check of each connection before sampling it: if every poi provably stays farther from the obstacles than the distance
+   * at which it could be slowed down, the scaling factor is 1.0 and no sample is evaluated (see isFarFromObstacles). The result does not change.
+   * The check costs the pois positions at the endpoints, so it pays off when most connections are far from the obstacles; the statistics below
+   * tell how often it fires.
+   */
+  void setQuickAccept(const bool& quick_accept)
+  {
+    waitForSubmittedPenalties();
+    quick_accept_ = quick_accept;
+  }
+  bool getQuickAccept(){return quick_accept_;}
+
+  unsigned long getQuickAcceptChecks(){return quick_accept_checks_;}
+  unsigned long getQuickAccepts(){return quick_accepts_;}
+  double getQuickAcceptRate()
+  {
+    unsigned long checks = quick_accept_checks_;
+    return (checks>0)? ((double) quick_accepts_)/((double) checks): 0.0;
+  }
+  void resetQuickAcceptStatistics()
+  {
+    quick_accept_checks_ = 0;
+    quick_accepts_ = 0;
+  }
+
+  /**
+   * @brief setQuadrature enables the computation of the average scaling factor as the integral of the scaling factor along the connection, using an
+   * adaptive Gauss-Kronrod (7-15 points) quadrature instead of the uniform sampling. Each interval is split until the Kronrod and Gauss estimates
+   * agree within the tolerances, so the smooth parts of a connection need far fewer forward kinematics evaluations; the parts with an infinite
+   * scaling factor and the short connections are sampled uniformly with step max_step_size_, as without quadrature.
+   * @param absolute_tolerance is the tolerance on the average scaling factor, shared among the intervals proportionally to their length.
+   * @param relative_tolerance is the tolerance relative to the integral over each interval.
+   */
+  void setQuadrature(const bool& quadrature, const double& absolute_tolerance=1e-03, const double& relative_tolerance=1e-03)
+  {
+    waitForSubmittedPenalties();
+
+    quadrature_ = quadrature;
+    quadrature_absolute_tolerance_ = std::max(absolute_tolerance,0.0);
+    quadrature_relative_tolerance_ = std::max(relative_tolerance,0.0);
+    increaseSceneVersion();
+  }
+  bool getQuadrature(){return quadrature_;}
+
+  /**
+   * @brief startAnytimeEvaluation starts the multi-resolution evaluation of connection (q1,q2): the connection is sampled on a coarse dyadic lattice,
+   * and the average scaling factor is returned with the difference from the estimate of the previous level as estimated error (see AnytimeEvaluation).
+   * Then, refineAnytimeEvaluation halves the step reusing all the samples already evaluated, so that the cost of each connection depends on the
+   * precision needed (e.g., coarse costs for most connections, refined ones for the connections of the candidate solutions).
+   * @param initial_level is the level of the coarse lattice, with 2^initial_level+1 samples.
+   * @return the evaluation, its scaling_factor_ and estimated_error_ are the current estimate.
+   */
+  AnytimeEvaluationPtr startAnytimeEvaluation(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const unsigned int& initial_level=2);
+
+  /**
+   * @brief refineAnytimeEvaluation refines the evaluation level by level, while its estimated error is higher than target_error and the next level
+   * is expected to end within time_budget, given the time per sample of the last level evaluated. The finest level has a step not longer than max_step_size_.
+   * @param target_error is the error of interest, negative to refine up to the finest level.
+   * @param time_budget is the time available for the refinement (seconds).
+   * @return true if the estimated error is not higher than target_error or the evaluation is complete.
+   */
+  bool refineAnytimeEvaluation(const AnytimeEvaluationPtr& evaluation, const double& target_error=-1.0,
+                               const double& time_budget=std::numeric_limits<double>::max());
+
+  /**
+   * @brief computeInfluenceDistance computes the human-robot distance beyond which the safe velocity is higher than cartesian_speed,
+   * that is an obstacle farther than it cannot slow down a point of the robot moving at cartesian_speed or less.
+   * @param cartesian_speed is the maximum cartesian speed of the robot's points of interest.
+   * @return the influence distance.
+   */
+  double computeInfluenceDistance(const double& cartesian_speed)
+  {
+    double influence_distance = (std::pow(cartesian_speed-term2_,2.0)-term1_)/(2.0*max_cart_acc_);
+    return std::max(influence_distance,min_distance_);
+  }
 
   /**
     Getters
@@ -208,7 +559,14 @@ public:
    * @brief setObstaclesPositions sets the matrix of obstacles locations
    * @param obstacles_positions is the matrix containing in the columns the location of each obstacle as x,y,z
    */
-  virtual void setObstaclesPositions(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions){obstacles_positions_ = obstacles_positions;}
+  virtual void setObstaclesPositions(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions)
+  {
+    waitForSubmittedPenalties();
+
+    obstacles_positions_ = obstacles_positions;
+    updateObstaclesIndexes();
+    increaseSceneVersion();
+  }
 
   /**
    * @brief addObstaclePosition adds an obstacle to the already existing obstacles matrix.
@@ -219,7 +577,106 @@ public:
   /**
    * @brief clearObstaclePosition clears the matrix of obstacles locations
    */
-  virtual void clearObstaclesPositions(){obstacles_positions_.resize(3,0);}
+  virtual void clearObstaclesPositions()
+  {
+    waitForSubmittedPenalties();
+
+    obstacles_positions_.resize(3,0);
+    updateObstaclesIndexes();
+    increaseSceneVersion();
+  }
+
+  /**
+   * @brief setObstaclesIndexThreshold sets the minimum number of obstacles to search them with a k-d tree instead of a linear scan.
+   */
+  virtual void setObstaclesIndexThreshold(const unsigned int& threshold)
+  {
+    waitForSubmittedPenalties();
+    obstacles_index_threshold_ = threshold;
+  }
+  unsigned int getObstaclesIndexThreshold(){return obstacles_index_threshold_;}
+
+  /**
+   * @brief useObstaclesIndex tells if the obstacles are searched with the k-d tree.
+   */
+  bool useObstaclesIndex(){return obstacles_positions_.cols()>=obstacles_index_threshold_;}
+
+  /**
+   * @brief setDistanceField enables the distance-field pre-filter over the workcell [min_corner,max_corner], rebuilt every time the obstacles change.
+   * A lower bound of the distance from the closest obstacle is read from the field in constant time, so the pois provably far from the obstacles are
+   * discarded without looping over them; the other pois, and those outside the workcell, are evaluated over all the obstacles as usual. The results are
+   * the same as without the field, but the cost is not constant: the closer the robot is to the obstacles, the fewer pois are discarded.
+   * @param resolution is the distance between adjacent nodes of the field.
+   */
+  virtual void setDistanceField(const Eigen::Vector3d& min_corner, const Eigen::Vector3d& max_corner, const double& resolution)
+  {
+    waitForSubmittedPenalties();
+
+    distance_field_ = std::make_shared<DistanceField>(min_corner,max_corner,resolution);
+    distance_field_->build(obstacles_positions_);
+    increaseSceneVersion();
+  }
+  virtual void disableDistanceField()
+  {
+    waitForSubmittedPenalties();
+
+    distance_field_ = nullptr;
+    increaseSceneVersion();
+  }
+  virtual DistanceFieldPtr getDistanceField(){return distance_field_;}
+
+  /**
+   * @brief setInstructionSet selects the instruction set used to compute the 2D scaling factor (the best supported one by default).
+   */
+  void setInstructionSet(const ScalingFactorKernel::InstructionSet& instruction_set)
+  {
+    waitForSubmittedPenalties();
+    scaling_factor_kernel_.setInstructionSet(instruction_set);
+  }
+  ScalingFactorKernel::InstructionSet getInstructionSet(){return scaling_factor_kernel_.getInstructionSet();}
+
+  /**
+   * @brief enableKinematicsStore enables the storage of the kinematics of the evaluated connections. Since it does not depend on the obstacles,
+   * the scaling factor of a stored connection is computed again without any forward kinematics call when the obstacles move.
+   * Useful when the same connections are evaluated many times (e.g., a fixed roadmap with a moving human).
+   * The parallel estimators share the store among their threads.
+   * @param capacity is the maximum number of stored connections, the least recently used ones are evicted.
+   * @param resolution is the resolution used to quantize the configurations.
+   */
+  void enableKinematicsStore(const size_t& capacity=10000, const double& resolution=1e-06)
+  {
+    waitForSubmittedPenalties();
+
+    kinematics_store_ = std::make_shared<EdgeKinematicsStore>(capacity,resolution);
+  }
+
+  void disableKinematicsStore()
+  {
+    waitForSubmittedPenalties();
+
+    kinematics_store_ = nullptr;
+  }
+
+  EdgeKinematicsStorePtr getKinematicsStore()
+  {
+    return kinematics_store_;
+  }
+
+  /**
+   * @brief computeEdgeKinematics computes the poi positions and velocities at each sample of the connection (q1,q2).
+   * The parallel estimators spread the samples among their threads.
+   * @param q1.
+   * @param q2.
+   * @return the kinematics of the connection.
+   */
+  virtual EdgeKinematicsPtr computeEdgeKinematics(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2);
+
+  /**
+   * @brief computeScalingFactorFromKinematics computes the average scaling factor of a connection given its kinematics, without any forward kinematics call.
+   * @param kinematics is the kinematics of the connection, see computeEdgeKinematics.
+   * @return the average scaling factor.
+   */
+  virtual double computeScalingFactorFromKinematics(const EdgeKinematics& kinematics) = 0;
 
   /**
    * @brief computeWorstCaseScalingFactor computes an approximation of the average scaling factor the robot will experience travelling from
@@ -232,6 +689,62 @@ public:
    */
   virtual double computeScalingFactor(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2) = 0;
 
+  /**
+   * @brief computeScalingFactorBounded computes the average scaling factor as computeScalingFactor, but it stops as soon as the average
+   * is proven to be higher than max_scaling_factor. By default, it computes the exact average scaling factor.
+   * @param q1.
+   * @param q2.
+   * @param max_scaling_factor is the scaling factor of interest.
+   * @return the average scaling factor, if it is not higher than max_scaling_factor. Otherwise, a lower bound of it higher than max_scaling_factor.
+   */
+  virtual double computeScalingFactorBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& /*max_scaling_factor*/)
+  {
+    return computeScalingFactor(q1,q2);
+  }
+
+  /**
+   * @brief computeScalingFactors computes the average scaling factor of a batch of connections. By default, it calls computeScalingFactor
+   * on each connection. Derived classes override it to share the setup work among the connections.
+   * @param connections is the vector of (q1,q2) pairs.
+   * @return the average scaling factors, in the same order of connections.
+   */
+  virtual std::vector<double> computeScalingFactors(const pathplan::ConfigurationsPairs& connections)
+  {
+    std::vector<double> scaling_factors;
+    scaling_factors.reserve(connections.size());
+
+    for(const pathplan::ConfigurationsPair& connection:connections)
+      scaling_factors.push_back(computeScalingFactor(connection.first,connection.second));
+
+    return scaling_factors;
+  }
+
+  /**
+   * @brief computeScalingFactorsBounded computes the scaling factors of a batch of connections as computeScalingFactorBounded. By default, it calls
+   * computeScalingFactorBounded on each connection.
+   * @param connections is the vector of (q1,q2) pairs.
+   * @param max_scaling_factor is the scaling factor of interest, the same for all the connections.
+   * @return the scaling factors, in the same order of connections.
+   */
+  virtual std::vector<double> computeScalingFactorsBounded(const pathplan::ConfigurationsPairs& connections, const double& max_scaling_factor)
+  {
+    std::vector<double> scaling_factors;
+    scaling_factors.reserve(connections.size());
+
+    for(const pathplan::ConfigurationsPair& connection:connections)
+      scaling_factors.push_back(computeScalingFactorBounded(connection.first,connection.second,max_scaling_factor));
+
+    return scaling_factors;
+  }
+
+  /**
+   * @brief computePathScalingFactors computes the average scaling factor of each connection of a path. By default, it calls computeScalingFactors
+   * on the connections between consecutive waypoints. Derived classes override it to evaluate the samples of the whole path at once.
+   * @param waypoints are the configurations of the path.
+   * @return the average scaling factors of the connections, waypoints.size()-1 elements (1.0 for coincident waypoints).
+   */
+  virtual std::vector<double> computePathScalingFactors(const pathplan::Waypoints& waypoints);
+
   /**
    * From CostPenaltyClass
    */
@@ -241,7 +754,159 @@ public:
     return computeScalingFactor(q1,q2);
   }
 
+  virtual double computePenaltyBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_penalty) override
+  {
+    return computeScalingFactorBounded(q1,q2,max_penalty);
+  }
+
+  virtual std::vector<double> computePenalties(const pathplan::ConfigurationsPairs& connections) override
+  {
+    return computeScalingFactors(connections);
+  }
+
+  virtual std::vector<double> computePathPenalties(const pathplan::Waypoints& waypoints) override
+  {
+    return computePathScalingFactors(waypoints);
+  }
+
   virtual pathplan::CostPenaltyPtr clone() = 0;
 };
 
+template<typename ScalingFactorFunction>
+double SSM15066Estimator::integrateScalingFactor(const ScalingFactorFunction& scaling_factor_of_q, const rosdyn::ChainPtr& chain, Workspace& workspace,
+                                                 const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor)
+{
+  /* Same joints velocity of the sampling, see computeScalingFactor */
+  workspace.connection_vector = q2-q1;
+  double slowest_joint_time = (inv_max_speed_.cwiseProduct(workspace.connection_vector)).cwiseAbs().maxCoeff();
+  workspace.dq = workspace.connection_vector/slowest_joint_time;
+
+  double length = workspace.connection_vector.norm();
+  unsigned int iter = std::max(std::ceil(length/max_step_size_),1.0);
+
+  /* The integral over the whole connection, of length 1 in s, is the average scaling factor */
+  double res;
+  if(mayHaveInfiniteSample(chain,workspace,q1,iter))
+  {
+    if(verbose_>0)
+      ROS_ERROR("the scaling factor may be infinite along the connection, sample it uniformly");
+
+    res = sampleScalingFactorOnInterval(scaling_factor_of_q,workspace,q1,0.0,1.0,iter,0.0,max_scaling_factor);
+  }
+  else
+  {
+    res = integrateScalingFactorOnInterval(scaling_factor_of_q,workspace,q1,length,0.0,1.0,0.0,max_scaling_factor);
+  }
+
+  if(verbose_>0)
+    ROS_ERROR_STREAM("scaling factor integrated along the connection "<<res);
+
+  return std::max(res,1.0);
+}
+
+template<typename ScalingFactorFunction>
+double SSM15066Estimator::integrateScalingFactorOnInterval(const ScalingFactorFunction& scaling_factor_of_q, Workspace& workspace, const Eigen::VectorXd& q1,
+                                                           const double& length, const double& a, const double& b, const double& integral_before,
+                                                           const double& max_scaling_factor)
+{
+  Eigen::VectorXd& q = workspace.q;
+  const Eigen::VectorXd& connection_vector = workspace.connection_vector;
+
+  /* Samples of the uniform sampling in [a,b], which is cheaper than the quadrature if they are no more than the Kronrod nodes */
+  unsigned int iter = std::max(std::ceil(length*(b-a)/max_step_size_),1.0);
+  bool uniform_sampling = (iter+1<=15);
+
+  double center = 0.5*(a+b);
+  double half_width = 0.5*(b-a);
+  double kronrod = 0.0;
+  double gauss = 0.0;
+  double f_left, f_right;
+  bool infinite = false;
+
+  if(not uniform_sampling)
+  {
+    q = q1+center*connection_vector;
+    f_left = scaling_factor_of_q(q);
+    infinite = (f_left == std::numeric_limits<double>::infinity());
+
+    kronrod = kronrod_weights_[7]*f_left;
+    gauss = gauss_weights_[3]*f_left;
+
+    for(unsigned int i=0;i<7 && not infinite;i++)
+    {
+      q = q1+(center-half_width*kronrod_nodes_[i])*connection_vector;
+      f_left = scaling_factor_of_q(q);
+      q = q1+(center+half_width*kronrod_nodes_[i])*connection_vector;
+      f_right = scaling_factor_of_q(q);
+
+      infinite = (f_left == std::numeric_limits<double>::infinity() || f_right == std::numeric_limits<double>::infinity());
+
+      kronrod += kronrod_weights_[i]*(f_left+f_right);
+      if(i%2 == 1)
+        gauss += gauss_weights_[i/2]*(f_left+f_right);
+    }
+
+    /* Near an infinite scaling factor the integrand is not smooth, sample it uniformly */
+    if(infinite)
+    {
+      uniform_sampling = true;
+    }
+    else
+    {
+      kronrod *= half_width;
+      gauss *= half_width;
+
+      double tolerance = std::max(quadrature_absolute_tolerance_*(b-a),quadrature_relative_tolerance_*kronrod);
+      if(std::abs(kronrod-gauss)<=tolerance)
+        return kronrod;
+
+      /* Split the interval if each half is still worth a quadrature, otherwise sample it uniformly */
+      if(iter+1<2*15)
+        uniform_sampling = true;
+    }
+  }
+
+  if(uniform_sampling)
+    return sampleScalingFactorOnInterval(scaling_factor_of_q,workspace,q1,a,b,iter,integral_before,max_scaling_factor);
+
+  double left_integral = integrateScalingFactorOnInterval(scaling_factor_of_q,workspace,q1,length,a,center,integral_before,max_scaling_factor);
+  if(left_integral == std::numeric_limits<double>::infinity())
+    return left_integral;
+
+  /* The scaling factor is at least 1.0 on the rest of the connection, stop if the average is already proven to be higher than the bound */
+  if(integral_before+left_integral+(1.0-center)>max_scaling_factor)
+    return left_integral+(b-center);
+
+  return left_integral+integrateScalingFactorOnInterval(scaling_factor_of_q,workspace,q1,length,center,b,integral_before+left_integral,max_scaling_factor);
+}
+
+template<typename ScalingFactorFunction>
+double SSM15066Estimator::sampleScalingFactorOnInterval(const ScalingFactorFunction& scaling_factor_of_q, Workspace& workspace, const Eigen::VectorXd& q1,
+                                                        const double& a, const double& b, const unsigned int& iter, const double& integral_before,
+                                                        const double& max_scaling_factor)
+{
+  Eigen::VectorXd& q = workspace.q;
+
+  double integral;
+  double sum_scaling_factor = 0.0;
+  double max_scaling_factor_of_q;
+  for(unsigned int i=0;i<iter+1;i++)
+  {
+    q = q1+(a+i*(b-a)/iter)*workspace.connection_vector;
+    max_scaling_factor_of_q = scaling_factor_of_q(q);
+
+    if(max_scaling_factor_of_q == std::numeric_limits<double>::infinity())
+      return std::numeric_limits<double>::infinity();
+
+    sum_scaling_factor += max_scaling_factor_of_q;
+
+    /* Each remaining sample adds at least 1.0, stop if the average is already proven to be higher than the bound */
+    integral = (b-a)*(sum_scaling_factor+(iter-i))/((double) iter+1);
+    if(integral_before+integral+(1.0-b)>max_scaling_factor)
+      return integral;
+  }
+
+  return (b-a)*sum_scaling_factor/((double) iter+1);
+}
+
 }
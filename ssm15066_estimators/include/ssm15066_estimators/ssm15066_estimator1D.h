@@ -38,6 +38,7 @@ typedef std::shared_ptr<SSM15066Estimator1D> SSM15066Estimator1DPtr;
   * @brief The SSM15066Estimator1D class is a 1D dSSM estimator, that means that the robot is considered as it is always moving in the direction
   * of the human. It is a more conservative version of SSM15066Estimator2D but less computational expensive.
   * It computes the scaling factor for each configuration xi along a connection (xs,xg) and then the mean value.
+  * The human-robot minimum distance is measured on all the links of the chain, while only the speeds of the pois are considered (see setDistanceFromPoisOnly).
   * The computation is sequential.
   */
 class SSM15066Estimator1D: public SSM15066Estimator
@@ -45,21 +46,142 @@ class SSM15066Estimator1D: public SSM15066Estimator
 protected:
   MinDistanceSolverPtr min_distance_solver_;
 
+  /**
+   * @brief min_poi_speed_ is the speed below which a poi is considered still, so that its scaling factor is 1.0 (see setMinPoiSpeed).
+   */
+  double min_poi_speed_;
+
+  /**
+   * @brief distance_from_pois_only_ is true if the minimum distance is measured on the pois only, false (default) if on all the links.
+   * When false, poi_kinematics_ computes the kinematics of all the links and is_poi_[i] tells if its i-th frame is a poi, whose speed is considered.
+   */
+  bool distance_from_pois_only_;
+  std::vector<bool> is_poi_;
+
+  /**
+   * @brief updatePoiIdxs updates the kinematics frames (all the links, or the pois only) of poi_kinematics_ and min_distance_solver_.
+   */
+  void updatePoiIdxs() override;
+
+  /**
+   * @brief computeScalingFactor computes the average scaling factor along (q1,q2) using the given chain and min distance solver.
+   * It assumes obstacles are present in the scene.
+   * @param chain is the chain used to compute the pois twists.
+   * @param min_distance_solver is the solver used to compute the human-robot minimum distance.
+   * @param workspace holds the buffers used by the computation, one for each thread as chain and min_distance_solver.
+   * @param q1.
+   * @param q2.
+   * @param max_scaling_factor stops the computation as soon as the average is proven to be higher than it (see computeScalingFactorBounded).
+   * @return the average scaling factor.
+   */
+  double computeScalingFactor(const rosdyn::ChainPtr& chain, const MinDistanceSolverPtr& min_distance_solver, Workspace& workspace,
+                              const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                              const double& max_scaling_factor=std::numeric_limits<double>::infinity());
+
+  /**
+   * @brief computeScalingFactorAtQ computes the scaling factor of configuration q, moving with velocity dq.
+   * @param chain is the chain used to compute the pois kinematics.
+   * @param min_distance_solver is the solver used to compute the human-robot minimum distance.
+   * @param workspace holds the pois kinematics and distance buffers.
+   * @param min_distance is filled with the human-robot minimum distance.
+   * @return the estimated scaling factor.
+   */
+  double computeScalingFactorAtQ(const rosdyn::ChainPtr& chain, const MinDistanceSolverPtr& min_distance_solver, Workspace& workspace,
+                                 const Eigen::VectorXd& q, const Eigen::VectorXd& dq, double& min_distance);
+
+  double computeScalingFactorOfSample(const Eigen::VectorXd& q, const Eigen::VectorXd& dq) override;
+
+  /**
+   * @brief computeScalingFactorAtDistance computes the scaling factor of a configuration given the human-robot minimum distance and the pois speeds.
+   * @param min_distance is the human-robot minimum distance.
+   * @param poi_speeds are the norms of the twists of the frames of poi_kinematics_, only the ones of the pois are considered.
+   * @return the estimated scaling factor.
+   */
+  double computeScalingFactorAtDistance(const double& min_distance, const Eigen::Ref<const Eigen::VectorXd>& poi_speeds);
+
+  /**
+   * @brief copySettingsTo copies the minimum distance and the minimum poi speed settings too, other must be a SSM15066Estimator1D.
+   */
+  void copySettingsTo(SSM15066Estimator& other) override;
+
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   SSM15066Estimator1D(const rosdyn::ChainPtr &chain, const double& max_step_size=0.05);
   SSM15066Estimator1D(const rosdyn::ChainPtr &chain, const double& max_step_size,
                     const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions);
 
+  /**
+   * @brief setDistanceFromPoisOnly measures the human-robot minimum distance on the pois only, instead of on all the links (false by default).
+   * It is faster when the pois are a subset of the links, but the links which are not pois are not checked against the obstacles.
+   */
+  void setDistanceFromPoisOnly(const bool& distance_from_pois_only)
+  {
+    waitForSubmittedPenalties();
+
+    distance_from_pois_only_ = distance_from_pois_only;
+    updatePoiIdxs();
+
+    if(kinematics_store_)
+      kinematics_store_->clear();
+
+    increaseSceneVersion();
+  }
+  bool getDistanceFromPoisOnly(){return distance_from_pois_only_;}
+
+  /**
+   * @brief setMinPoiSpeed sets the speed below which a poi is considered still and it does not slow down the robot (1e-02 by default).
+   * With min_poi_speed = 0.0, the scaling factor of each sample is an upper bound of the one computed by SSM15066Estimator2D.
+   */
+  void setMinPoiSpeed(const double& min_poi_speed)
+  {
+    waitForSubmittedPenalties();
+
+    min_poi_speed_ = std::max(min_poi_speed,0.0);
+    increaseSceneVersion();
+  }
+  double getMinPoiSpeed(){return min_poi_speed_;}
+
   void addObstaclePosition(const Eigen::Vector3d& obstacle_position) override;
   void setObstaclesPositions(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions) override;
 
   void clearObstaclesPositions() override
   {
+    waitForSubmittedPenalties();
+
+    SSM15066Estimator::clearObstaclesPositions();
     min_distance_solver_->clearObstaclesPositions();
-    obstacles_positions_.resize(3,0);
   }
+
+  void setObstaclesIndexThreshold(const unsigned int& threshold) override
+  {
+    waitForSubmittedPenalties();
+
+    SSM15066Estimator::setObstaclesIndexThreshold(threshold);
+    min_distance_solver_->setObstaclesIndexThreshold(threshold);
+  }
+
+  /**
+   * @brief setDistanceField enables the distance-field pre-filter in min_distance_solver_, which computes the minimum distance (see SSM15066Estimator::setDistanceField).
+   */
+  void setDistanceField(const Eigen::Vector3d& min_corner, const Eigen::Vector3d& max_corner, const double& resolution) override
+  {
+    waitForSubmittedPenalties();
+
+    min_distance_solver_->setDistanceField(std::make_shared<DistanceField>(min_corner,max_corner,resolution));
+    increaseSceneVersion();
+  }
+  void disableDistanceField() override
+  {
+    waitForSubmittedPenalties();
+
+    min_distance_solver_->setDistanceField(nullptr);
+    increaseSceneVersion();
+  }
+  DistanceFieldPtr getDistanceField() override {return min_distance_solver_->getDistanceField();}
   virtual double computeScalingFactor(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2) override;
+  virtual double computeScalingFactorBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor) override;
+  virtual std::vector<double> computeScalingFactors(const pathplan::ConfigurationsPairs& connections) override;
+  virtual double computeScalingFactorFromKinematics(const EdgeKinematics& kinematics) override;
   virtual pathplan::CostPenaltyPtr clone() override;
 };
 
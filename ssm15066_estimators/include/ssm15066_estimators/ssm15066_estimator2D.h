@@ -43,6 +43,146 @@ class SSM15066Estimator2D: public SSM15066Estimator
 protected:
   bool dataset_creation_ = false;
 
+  /**
+   * @brief kinematics_interpolation_ enables the interpolation of the pois kinematics between anchors, see setKinematicsInterpolation.
+   */
+  bool kinematics_interpolation_ = false;
+  unsigned int anchors_stride_ = 4;
+  double interpolation_position_tolerance_ = 1e-03;
+  double interpolation_velocity_tolerance_ = 1e-02;
+
+  /**
+   * @brief computeScalingFactor computes the average scaling factor along (q1,q2) using the given chain for the kinematics computations.
+   * It assumes obstacles are present in the scene.
+   * @param chain is the chain to use, so that different threads can evaluate connections concurrently using their own chain.
+   * @param workspace holds the buffers used by the computation, one for each thread as chain.
+   * @param q1.
+   * @param q2.
+   * @param max_scaling_factor stops the computation as soon as the average is proven to be higher than it (see computeScalingFactorBounded).
+   * @return the average scaling factor.
+   */
+  double computeScalingFactor(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                              const double& max_scaling_factor=std::numeric_limits<double>::infinity());
+
+  /**
+   * @brief computeScalingFactorUniform computes the average scaling factor of the uniform sampling of (q1,q2), skipping samples if adaptive sampling is enabled.
+   * @param max_scaling_factor stops the computation as soon as the average is proven to be higher than it (see computeScalingFactorBounded).
+   */
+  double computeScalingFactorUniform(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                                             const double& max_scaling_factor);
+
+  /**
+   * @brief setUniformSampling sets workspace.connection_vector, workspace.dq and workspace.delta_q for the uniform sampling of (q1,q2).
+   * @return the number of steps iter, the samples are q1+i*delta_q with i=0..iter.
+   */
+  unsigned int setUniformSampling(Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2);
+
+  /**
+   * @brief computeScalingFactorInterpolated is the same as computeScalingFactor, but the forward kinematics is computed only at the anchors
+   * (one sample every anchors_stride_) and the pois kinematics at the samples in between is interpolated: positions by cubic Hermite
+   * interpolation (the pois velocities are the derivatives of the positions along the connection), velocities linearly.
+   * The error of the interpolation is estimated per segment from the mismatch between the chord and the mean of the velocities at the anchors;
+   * if it is higher than the tolerances, the samples of the segment are computed exactly. The interpolated kinematics is trusted only up to the
+   * tolerances, so an interpolated sample has scaling factor 1.0 only if arePoisFarFromObstacles proves it with the tolerances as margins,
+   * otherwise it is computed exactly.
+   */
+  double computeScalingFactorInterpolated(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                                          const double& max_scaling_factor=std::numeric_limits<double>::infinity());
+
+  /**
+   * @brief computeScalingFactorFromKinematics is the same as computeScalingFactorFromKinematics(kinematics), using the buffers of workspace.
+   */
+  double computeScalingFactorFromKinematics(Workspace& workspace, const EdgeKinematics& kinematics);
+
+  /**
+   * @brief arePoisFarFromObstacles tells if every poi is farther from the obstacles than its influence distance, with its distance reduced by
+   * position_margin and its speed increased by speed_margin, i.e. if the scaling factor is 1.0 for any pois kinematics within the margins.
+   */
+  bool arePoisFarFromObstacles(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                               const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                               const double& position_margin, const double& speed_margin);
+
+  /**
+   * @brief computeScalingFactorBothWays is the same as the public one, but it uses the given chain and workspace.
+   */
+  std::pair<double,double> computeScalingFactorBothWays(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2);
+
+  /**
+   * @brief sumScalingFactorsBothWays adds the scaling factors of the samples [first,last) of (q1,q2) to forward_sum and the ones of the same samples
+   * travelled from q2 to q1 to backward_sum. workspace.dq and workspace.delta_q must be already set for (q1,q2).
+   * A sum becomes infinity at the first infinite sample of its direction, the evaluation stops when both sums are infinite.
+   */
+  void sumScalingFactorsBothWays(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const unsigned int& first,
+                                 const unsigned int& last, double& forward_sum, double& backward_sum);
+
+  double computeScalingFactorOfSample(const Eigen::VectorXd& q, const Eigen::VectorXd& dq) override;
+
+  /**
+   * @brief computeScalingFactorAtQ is the same as the public one, but it uses the given chain and workspace.
+   */
+  double computeScalingFactorAtQ(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q, const Eigen::VectorXd& dq, double& tangential_speed,
+                                 double& distance, double &safe_vel, Eigen::Vector3d &poi_position);
+
+  /**
+   * @brief computeScalingFactorOfPair computes the scaling factor due to a single obstacle-poi pair.
+   * @param obstacle_position is the obstacle position.
+   * @param poi_position is the poi position.
+   * @param poi_velocity is the poi linear velocity.
+   * @param tangential_speed is filled with the component of the poi velocity towards the obstacle.
+   * @param distance is filled with the obstacle-poi distance.
+   * @param safe_vel is filled with the safe velocity at that distance (not computed if the poi is going away, unless dataset_creation_ is true).
+   * @return the scaling factor, infinity if the poi must stop.
+   */
+  double computeScalingFactorOfPair(const Eigen::Vector3d& obstacle_position, const Eigen::Vector3d& poi_position, const Eigen::Vector3d& poi_velocity,
+                                    double& tangential_speed, double& distance, double& safe_vel);
+
+  /**
+   * @brief computeScalingFactorAtPois computes the scaling factor given the pois positions and linear velocities at a configuration.
+   * The outputs are the same of computeScalingFactorAtQ. With many obstacles (see useObstaclesIndex) and dataset_creation_ false, only the obstacles
+   * closer to each poi than the distance at which its safe velocity equals its speed are considered, since the farther ones give a scaling factor of 1.0;
+   * if no obstacle slows the robot down, the outputs keep their default values.
+   * @param poi_positions are the pois positions (columns) in base frame.
+   * @param poi_velocities are the pois linear velocities (columns) in base frame.
+   * @param obstacles_idxs is the buffer filled by the k-d tree search.
+   * @return the estimated scaling factor.
+   */
+  double computeScalingFactorAtPois(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                    const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                                    double& tangential_speed, double& distance, double &safe_vel, Eigen::Vector3d &poi_position,
+                                    std::vector<Eigen::Index>& obstacles_idxs);
+
+  /**
+   * @brief computeMaxScalingFactorPrefiltered computes the same scaling factor of computeMaxScalingFactorFromObstacles, pre-filtering the pois with
+   * distance_field_: the pois whose lower bound of the distance is higher than their influence distance are discarded (scaling factor 1.0), the other
+   * ones are evaluated over all the obstacles by computeMaxScalingFactorFromObstacles, so near the obstacles the cost is the one without the field.
+   */
+  double computeMaxScalingFactorPrefiltered(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                          const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                                          std::vector<Eigen::Index>& obstacles_idxs);
+
+  /**
+   * @brief computeMaxScalingFactorFromObstacles computes the scaling factor of the pois over all the obstacles: with computeScalingFactorAtPois if
+   * verbosity or dataset creation are required or the obstacles are searched with the k-d tree, otherwise with the vectorized scaling_factor_kernel_.
+   */
+  double computeMaxScalingFactorFromObstacles(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                              const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                                              std::vector<Eigen::Index>& obstacles_idxs);
+
+  /**
+   * @brief computeMaxScalingFactorAtPois computes the same scaling factor of computeScalingFactorAtPois without its outputs. If no verbosity nor dataset
+   * creation is required, it discards the pois far from the obstacles with the distance field if enabled (see computeMaxScalingFactorPrefiltered); otherwise,
+   * if the obstacles are not searched with the k-d tree, it uses the vectorized scaling_factor_kernel_.
+   * @return the estimated scaling factor.
+   */
+  double computeMaxScalingFactorAtPois(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                       const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                                       std::vector<Eigen::Index>& obstacles_idxs);
+
+  /**
+   * @brief copySettingsTo copies the dataset creation and kinematics interpolation settings too, other must be a SSM15066Estimator2D.
+   */
+  void copySettingsTo(SSM15066Estimator& other) override;
+
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   SSM15066Estimator2D(const rosdyn::ChainPtr &chain, const double& max_step_size=0.05);
@@ -51,9 +191,30 @@ public:
 
   void setDatasetCreation(const bool dataset_creation)
   {
+    waitForSubmittedPenalties();
     dataset_creation_ = dataset_creation;
   }
 
+  /**
+   * @brief setKinematicsInterpolation enables the interpolation of the pois kinematics between exact samples, to reduce the forward kinematics calls
+   * (see computeScalingFactorInterpolated). Adaptive sampling is not applied when it is enabled, the parallel estimators evaluate each connection in the calling thread.
+   * @param anchors_stride is the number of samples between two consecutive anchors, where the kinematics is computed exactly.
+   * @param position_tolerance is the maximum estimated error of the interpolated positions [m].
+   * @param velocity_tolerance is the maximum estimated error of the interpolated velocities [m/s].
+   */
+  void setKinematicsInterpolation(const bool& kinematics_interpolation, const unsigned int& anchors_stride=4,
+                                  const double& position_tolerance=1e-03, const double& velocity_tolerance=1e-02)
+  {
+    waitForSubmittedPenalties();
+    kinematics_interpolation_ = kinematics_interpolation;
+    anchors_stride_ = std::max(anchors_stride,1u);
+    interpolation_position_tolerance_ = position_tolerance;
+    interpolation_velocity_tolerance_ = velocity_tolerance;
+
+    increaseSceneVersion();
+  }
+  bool getKinematicsInterpolation(){return kinematics_interpolation_;}
+
   /**
    * @brief computeScalingFactorAtQ computes the scaling factor given configuration q and velocity vector dq
    * @param q robot configuration
@@ -68,7 +229,21 @@ public:
                                  double& distance, double &safe_vel, Eigen::Vector3d &poi_position);
   double computeScalingFactorAtQ(const Eigen::VectorXd& q, const Eigen::VectorXd& dq);
 
+  /**
+   * @brief computeScalingFactorBothWays computes the average scaling factors of (q1,q2) and (q2,q1) at once. The reversed connection has the same
+   * samples and the opposite joints velocity, so the poses, the distances and the safe velocities are the same and only the sign of the tangential
+   * speeds changes: the forward kinematics is computed once per sample for both directions. The results match the ones of two computeScalingFactor calls
+   * up to rounding errors, except with adaptive sampling: the skipped samples are chosen once for both directions, so each result differs from the one
+   * of computeScalingFactor, but both differ from the uniform sampling at most by the adaptive sampling tolerance. With interpolation, quadrature or
+   * the kinematics store, the two connections are evaluated separately.
+   * @return the scaling factors of (q1,q2) (first) and of (q2,q1) (second).
+   */
+  virtual std::pair<double,double> computeScalingFactorBothWays(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2);
+
   virtual double computeScalingFactor(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2) override;
+  virtual double computeScalingFactorBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor) override;
+  virtual std::vector<double> computeScalingFactors(const pathplan::ConfigurationsPairs& connections) override;
+  virtual double computeScalingFactorFromKinematics(const EdgeKinematics& kinematics) override;
   virtual pathplan::CostPenaltyPtr clone() override;
 };
 
@@ -0,0 +1,120 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <unordered_map>
+#include <unordered_set>
+#include <ssm15066_estimators/edge_kinematics.h>
+
+namespace ssm15066_estimator
+{
+class SweptVolumeIndex;
+typedef std::shared_ptr<SweptVolumeIndex> SweptVolumeIndexPtr;
+
+/**
+ * @brief The SweptVolumeIndex class stores in a uniform grid the Cartesian bounding box swept by the robot's points of interest
+ * along each evaluated connection. When the obstacles move, it returns only the connections whose bounding box is within the
+ * influence radius of an obstacle that actually moved, so that only their cost needs to be computed again.
+ * The influence radius is the distance beyond which an obstacle cannot slow down the robot (see SSM15066Estimator::computeInfluenceDistance).
+ */
+class SweptVolumeIndex
+{
+protected:
+  struct Box
+  {
+    Eigen::Vector3d min_;
+    Eigen::Vector3d max_;
+    std::vector<uint64_t> cells_;
+  };
+
+  /**
+   * @brief cell_size_ is the edge length of the grid cells.
+   */
+  double cell_size_;
+
+  /**
+   * @brief influence_radius_ is the maximum obstacle-box distance for which the connection needs to be evaluated again.
+   */
+  double influence_radius_;
+
+  /**
+   * @brief grid_ maps each cell to the connections whose box overlaps it, boxes_ maps each connection to its box.
+   */
+  std::unordered_map<uint64_t,std::vector<size_t>> grid_;
+  std::unordered_map<size_t,Box> boxes_;
+
+  Eigen::Vector3i cellOf(const Eigen::Vector3d& point) const;
+  uint64_t cellKey(const Eigen::Vector3i& cell) const;
+
+  /**
+   * @brief collect inserts in ids the connections whose box is closer than influence_radius_ to point.
+   */
+  void collect(const Eigen::Vector3d& point, std::unordered_set<size_t>& ids) const;
+
+public:
+  SweptVolumeIndex(const double& influence_radius, const double& cell_size=0.20);
+
+  void setInfluenceRadius(const double& influence_radius){influence_radius_ = influence_radius;}
+  double getInfluenceRadius(){return influence_radius_;}
+  double getCellSize(){return cell_size_;}
+  size_t size(){return boxes_.size();}
+
+  /**
+   * @brief insert adds (or replaces) the box swept by connection id.
+   * @param id identifies the connection, it is chosen by the user (e.g., the index of the connection in the roadmap).
+   * @param min_corner and max_corner are the corners of the box.
+   */
+  void insert(const size_t& id, const Eigen::Vector3d& min_corner, const Eigen::Vector3d& max_corner);
+
+  /**
+   * @brief insert adds (or replaces) the box swept by connection id computing it from the pois positions of its kinematics.
+   */
+  void insert(const size_t& id, const EdgeKinematics& kinematics);
+
+  void erase(const size_t& id);
+  void clear();
+
+  /**
+   * @brief query returns the connections whose box is closer than the influence radius to point.
+   */
+  std::vector<size_t> query(const Eigen::Vector3d& point) const;
+
+  /**
+   * @brief findInvalidatedConnections compares the old and the new obstacles positions and returns the connections within the influence radius
+   * of the old or new position of an obstacle that moved. If the number of obstacles changed, all of them are considered as moved.
+   * @param old_obstacles_positions are the obstacles positions used to compute the current costs.
+   * @param new_obstacles_positions are the updated obstacles positions.
+   * @param tolerance is the displacement below which an obstacle is considered still.
+   * @return the ids of the connections to evaluate again, in ascending order.
+   */
+  std::vector<size_t> findInvalidatedConnections(const Eigen::Matrix<double,3,Eigen::Dynamic>& old_obstacles_positions,
+                                                 const Eigen::Matrix<double,3,Eigen::Dynamic>& new_obstacles_positions,
+                                                 const double& tolerance=1e-06) const;
+};
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <vector>
+#include <eigen3/Eigen/Core>
+#include <min_distance_solvers/util.h>
+
+namespace ssm15066_estimator
+{
+/**
+ * @brief The Workspace struct collects the buffers used to evaluate the samples of a connection. Each estimator (and each thread of
+ * the parallel estimators) owns one, so that the buffers are allocated at the first evaluation and then reused: since the sizes
+ * depend only on the robot and on the pois, evaluating a connection does not allocate memory.
+ */
+struct Workspace
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /**
+   * @brief These are the quantities of the connection: q2-q1, the joints velocity and the joints displacement between consecutive samples.
+   */
+  Eigen::VectorXd connection_vector;
+  Eigen::VectorXd dq;
+  Eigen::VectorXd delta_q;
+
+  /**
+   * @brief q is the current sample.
+   */
+  Eigen::VectorXd q;
+
+  /**
+   * @brief poi_positions and poi_velocities are the pois positions and linear velocities (columns) in base frame at q.
+   */
+  Eigen::Matrix<double,3,Eigen::Dynamic> poi_positions;
+  Eigen::Matrix<double,3,Eigen::Dynamic> poi_velocities;
+
+  /**
+   * @brief next_poi_positions and next_poi_velocities are the pois kinematics at the next anchor, predicted_poi_positions and
+   * predicted_poi_velocities at the samples between two anchors (see SSM15066Estimator2D::setKinematicsInterpolation).
+   */
+  Eigen::Matrix<double,3,Eigen::Dynamic> next_poi_positions;
+  Eigen::Matrix<double,3,Eigen::Dynamic> next_poi_velocities;
+  Eigen::Matrix<double,3,Eigen::Dynamic> predicted_poi_positions;
+  Eigen::Matrix<double,3,Eigen::Dynamic> predicted_poi_velocities;
+
+  /**
+   * @brief reversed_poi_velocities are the pois linear velocities at q when the connection is travelled backward (see SSM15066Estimator2D::computeScalingFactorBothWays).
+   */
+  Eigen::Matrix<double,3,Eigen::Dynamic> reversed_poi_velocities;
+
+  /**
+   * @brief poi_twist_norms are the norms of the pois twists at q (1D estimators).
+   */
+  Eigen::VectorXd poi_twist_norms;
+
+  /**
+   * @brief distance is the human-robot minimum distance at q (1D estimators).
+   */
+  Distance distance;
+
+  /**
+   * @brief obstacles_idxs are the obstacles found by the radius search around a poi.
+   */
+  std::vector<Eigen::Index> obstacles_idxs;
+};
+
+}
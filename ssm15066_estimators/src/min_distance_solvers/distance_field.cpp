@@ -0,0 +1,248 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <min_distance_solvers/distance_field.h>
+#include <ros/ros.h>
+#include <cmath>
+#include <limits>
+
+namespace ssm15066_estimator
+{
+
+DistanceField::DistanceField(const Eigen::Vector3d& min_corner, const Eigen::Vector3d& max_corner, const double& resolution):
+  min_corner_(min_corner),max_corner_(max_corner),resolution_(resolution)
+{
+  if(resolution_<=0.0)
+  {
+    ROS_ERROR("distance field resolution must be positive, set equal to 0.05");
+    resolution_ = 0.05;
+  }
+
+  for(unsigned int dim=0;dim<3;dim++)
+  {
+    if(max_corner_(dim)<=min_corner_(dim))
+    {
+      ROS_ERROR_STREAM("distance field max corner must be higher than min corner along axis "<<dim<<", set equal to min corner + resolution");
+      max_corner_(dim) = min_corner_(dim)+resolution_;
+    }
+  }
+
+  inv_resolution_ = 1.0/resolution_;
+  for(unsigned int dim=0;dim<3;dim++)
+    n_nodes_(dim) = std::max((Eigen::Index) std::ceil((max_corner_(dim)-min_corner_(dim))*inv_resolution_)+1,(Eigen::Index) 2);
+
+  Eigen::Index n = n_nodes_.prod();
+  distances_.setConstant(n,std::numeric_limits<double>::max());
+  nearest_.assign(n,-1);
+  points_.resize(3,0);
+}
+
+void DistanceField::build(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions)
+{
+  points_ = obstacles_positions;
+  outside_.clear();
+
+  Eigen::Index n = n_nodes_.prod();
+  std::vector<double> squared_distances(n,std::numeric_limits<double>::max());
+  nearest_.assign(n,-1);
+
+  /* Each obstacle inside the workcell is a site at its closest node, the closest obstacle is kept if more obstacles share a node */
+  Eigen::Matrix<Eigen::Index,3,1> node;
+  Eigen::Index idx;
+  for(Eigen::Index i_obs=0;i_obs<points_.cols();i_obs++)
+  {
+    if(not isInside(points_.col(i_obs)))
+    {
+      outside_.push_back(i_obs);
+      continue;
+    }
+
+    for(unsigned int dim=0;dim<3;dim++)
+      node(dim) = std::min(std::max((Eigen::Index) std::round((points_(dim,i_obs)-min_corner_(dim))*inv_resolution_),(Eigen::Index) 0),n_nodes_(dim)-1);
+
+    idx = nodeIndex(node(0),node(1),node(2));
+    if(nearest_[idx]<0 || (points_.col(i_obs)-nodePosition(node(0),node(1),node(2))).squaredNorm()<
+                          (points_.col(nearest_[idx])-nodePosition(node(0),node(1),node(2))).squaredNorm())
+    {
+      nearest_[idx] = i_obs;
+      squared_distances[idx] = 0.0;
+    }
+  }
+
+  for(unsigned int dim=0;dim<3;dim++)
+    transformLines(dim,squared_distances,nearest_);
+
+  for(Eigen::Index k=0;k<n_nodes_(2);k++)
+    for(Eigen::Index j=0;j<n_nodes_(1);j++)
+      for(Eigen::Index i=0;i<n_nodes_(0);i++)
+        updateNode(i,j,k);
+}
+
+void DistanceField::transformLines(const unsigned int& dim, std::vector<double>& squared_distances, std::vector<Eigen::Index>& features) const
+{
+  Eigen::Index length = n_nodes_(dim);
+  Eigen::Index stride = (dim == 0)? 1: ((dim == 1)? n_nodes_(0): n_nodes_(0)*n_nodes_(1));
+
+  /* Buffers of a line: input values, lower envelope of the parabolas (vertexes and boundaries). Finite sentinels are used, since the package
+   * may be compiled with finite math only */
+  std::vector<double> f(length), z(length+1);
+  std::vector<Eigen::Index> f_features(length), v(length);
+
+  Eigen::Index first, k;
+  double s;
+  for(Eigen::Index line=0;line<n_nodes_.prod()/length;line++)
+  {
+    /* First node of the line */
+    if(dim == 0)
+      first = line*length;
+    else if(dim == 1)
+      first = (line%n_nodes_(0))+(line/n_nodes_(0))*n_nodes_(0)*n_nodes_(1);
+    else
+      first = line;
+
+    for(Eigen::Index q=0;q<length;q++)
+    {
+      f[q] = squared_distances[first+q*stride];
+      f_features[q] = features[first+q*stride];
+    }
+
+    /* Lower envelope of the parabolas (q-p)^2+f[p] over the nodes with a finite value */
+    k = -1;
+    for(Eigen::Index q=0;q<length;q++)
+    {
+      if(f_features[q]<0)  // no obstacle found yet
+        continue;
+
+      while(k>=0)
+      {
+        s = ((f[q]+q*q)-(f[v[k]]+v[k]*v[k]))/(2.0*(q-v[k]));
+        if(s>z[k])
+          break;
+        k--;
+      }
+
+      k++;
+      v[k] = q;
+      z[k] = (k == 0)? -std::numeric_limits<double>::max(): s;
+      z[k+1] = std::numeric_limits<double>::max();
+    }
+
+    if(k<0)  // no obstacle on this line yet
+      continue;
+
+    k = 0;
+    for(Eigen::Index q=0;q<length;q++)
+    {
+      while(z[k+1]<q)
+        k++;
+
+      squared_distances[first+q*stride] = (q-v[k])*(q-v[k])+f[v[k]];
+      features[first+q*stride] = f_features[v[k]];
+    }
+  }
+}
+
+void DistanceField::updateNode(const Eigen::Index& i, const Eigen::Index& j, const Eigen::Index& k)
+{
+  Eigen::Index idx = nodeIndex(i,j,k);
+  if(nearest_[idx]<0)
+    distances_(idx) = std::numeric_limits<double>::max();
+  else
+    distances_(idx) = (points_.col(nearest_[idx])-nodePosition(i,j,k)).norm();
+}
+
+void DistanceField::add(const Eigen::Vector3d& obstacle_position)
+{
+  points_.conservativeResize(Eigen::NoChange,points_.cols()+1);
+  points_.col(points_.cols()-1) = obstacle_position;
+
+  if(not isInside(obstacle_position))
+  {
+    outside_.push_back(points_.cols()-1);
+    return;
+  }
+
+  Eigen::Index idx;
+  for(Eigen::Index k=0;k<n_nodes_(2);k++)
+  {
+    for(Eigen::Index j=0;j<n_nodes_(1);j++)
+    {
+      for(Eigen::Index i=0;i<n_nodes_(0);i++)
+      {
+        idx = nodeIndex(i,j,k);
+        if((obstacle_position-nodePosition(i,j,k)).norm()<distances_(idx))
+        {
+          nearest_[idx] = points_.cols()-1;
+          updateNode(i,j,k);
+        }
+      }
+    }
+  }
+}
+
+bool DistanceField::lowerBound(const Eigen::Vector3d& point, double& distance) const
+{
+  Eigen::Vector3d coordinates = (point-min_corner_)*inv_resolution_;
+
+  Eigen::Matrix<Eigen::Index,3,1> node;
+  Eigen::Vector3d fraction;
+  for(unsigned int dim=0;dim<3;dim++)
+  {
+    if(not (coordinates(dim)>=0.0 && coordinates(dim)<=n_nodes_(dim)-1))
+      return false;
+
+    node(dim) = std::min((Eigen::Index) coordinates(dim),n_nodes_(dim)-2);
+    fraction(dim) = coordinates(dim)-node(dim);
+  }
+
+  distance = std::numeric_limits<double>::max();
+
+  /* Trilinear interpolation of the distance over the 8 nodes of the cell, if there are obstacles in the grid */
+  if(outside_.size()<(size_t) points_.cols())
+  {
+    double weight;
+    double interpolated_distance = 0.0;
+    for(unsigned int corner=0;corner<8;corner++)
+    {
+      weight = ((corner & 1)? fraction(0): 1.0-fraction(0))*
+               ((corner & 2)? fraction(1): 1.0-fraction(1))*
+               ((corner & 4)? fraction(2): 1.0-fraction(2));
+
+      interpolated_distance += weight*distances_(nodeIndex(node(0)+((corner & 1)? 1: 0),node(1)+((corner & 2)? 1: 0),node(2)+((corner & 4)? 1: 0)));
+    }
+
+    distance = interpolated_distance-getMaxError();
+  }
+
+  for(const Eigen::Index& i_obs: outside_)
+    distance = std::min(distance,(points_.col(i_obs)-point).norm());
+
+  return true;
+}
+
+}
@@ -33,20 +33,28 @@ namespace ssm15066_estimator
 MinDistanceSolver::MinDistanceSolver(const rosdyn::ChainPtr &chain):
   chain_(chain)
 {
+  obstacles_index_threshold_ = 32;
+  obstacles_index_ = std::make_shared<ObstaclesIndex>();
+  update_distance_field_ = true;
   obstacles_positions_.resize(3,0);
 
   links_names_ = chain_->getLinksName();
-  poi_names_ = links_names_;
+  poi_kinematics_.setChain(chain_);
+  setPoiNames(links_names_);
 }
 
 MinDistanceSolver:: MinDistanceSolver(const rosdyn::ChainPtr &chain,
                                       const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions):
   chain_(chain)
 {
+  obstacles_index_threshold_ = 32;
+  obstacles_index_ = std::make_shared<ObstaclesIndex>();
+  update_distance_field_ = true;
   setObstaclesPositions(obstacles_positions);
 
   links_names_ = chain_->getLinksName();
-  poi_names_ = links_names_;
+  poi_kinematics_.setChain(chain_);
+  setPoiNames(links_names_);
 }
 
 void MinDistanceSolver::addObstaclePosition(const Eigen::Vector3d& obstacle_position)
@@ -57,61 +65,133 @@ void MinDistanceSolver::addObstaclePosition(const Eigen::Vector3d& obstacle_posi
     obstacles_positions_.col(obstacles_positions_.cols()-1) = obstacle_position;
   else
     obstacles_positions_.col(obstacles_positions_.cols()-1) = obstacle_position.transpose();  // make it a column vector
+
+  obstacles_index_->build(obstacles_positions_);
+
+  if(distance_field_ && update_distance_field_)
+    distance_field_->add(obstacles_positions_.col(obstacles_positions_.cols()-1));
 }
 
 DistancePtr MinDistanceSolver::computeMinDistance(const Eigen::VectorXd& q)
 {
-  DistancePtr res = std::make_shared<Distance>();
   if(obstacles_positions_.cols() == 0)
   {
+    DistancePtr res = std::make_shared<Distance>();
     res->distance_ = std::numeric_limits<double>::infinity(); //set infinity when there are no obstacles
     return res;
   }
 
-  double distance;
-  unsigned int poi_idx, obs_idx;
-  Eigen::Vector3d distance_vector, min_distance_vector, i_poi_fk, poi_fk;
+  Eigen::Matrix<double,3,Eigen::Dynamic> poi_positions(3,poi_kinematics_.getPoisNumber());
+  poi_kinematics_.computePositions(chain_,q,poi_positions);
+
+  return computeMinDistance(q,poi_positions);
+}
+
+DistancePtr MinDistanceSolver::computeMinDistance(const Eigen::VectorXd& q, const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions)
+{
+  DistancePtr res = std::make_shared<Distance>();
+  computeMinDistance(q,poi_positions,*res);
+
+  return res;
+}
+
+void MinDistanceSolver::computeMinDistance(const Eigen::VectorXd& q, const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions, Distance& res)
+{
+  if(obstacles_positions_.cols() == 0)
+  {
+    res.distance_ = std::numeric_limits<double>::infinity(); //set infinity when there are no obstacles
+    return;
+  }
+
+  assert(poi_positions.cols() == (Eigen::Index) poi_kinematics_.getPoisNumber());
+
+  double distance, lower_bound;
+  Eigen::Index i_obs;
+  Eigen::Index obs_idx = 0;
+  Eigen::Index min_poi = 0;
 
   double min_distance = std::numeric_limits<double>::infinity();
-  std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d>> poi_poses_in_base = chain_->getTransformations(q);
 
-  for (Eigen::Index i_obs=0;i_obs<obstacles_positions_.cols();i_obs++)
+  /* With the distance field, the poi with the lowest lower bound of the distance is evaluated first, then the pois whose lower bound is not
+   * lower than the minimum distance found so far are skipped, since they cannot be closer to the obstacles */
+  Eigen::Index first_poi = -1;
+  if(distance_field_)
   {
-    for (size_t i_poi=0;i_poi<poi_poses_in_base.size();i_poi++)
+    double min_lower_bound = std::numeric_limits<double>::infinity();
+    for(Eigen::Index i_poi=0;i_poi<poi_positions.cols();i_poi++)
     {
-      //consider only links inside the poi_names_ list
-      if(std::find(poi_names_.begin(),poi_names_.end(),links_names_[i_poi])>=poi_names_.end())
-        continue;
-
-      i_poi_fk = poi_poses_in_base.at(i_poi).translation();
-      distance_vector = obstacles_positions_.col(i_obs)-i_poi_fk; //in base
-      distance = distance_vector.norm();
+      if(not distance_field_->lowerBound(poi_positions.col(i_poi),lower_bound))
+        lower_bound = 0.0;
 
-      if(distance<min_distance)
+      if(lower_bound<min_lower_bound)
       {
-        min_distance = distance;
-        min_distance_vector = distance_vector;
-        poi_fk = i_poi_fk;
-
-        poi_idx = i_poi;
-        obs_idx = i_obs;
+        min_lower_bound = lower_bound;
+        first_poi = i_poi;
       }
     }
+
+    min_distance = computePoiMinDistance(poi_positions.col(first_poi),obs_idx);
+    min_poi = first_poi;
+  }
+
+  for(Eigen::Index i_poi=0;i_poi<poi_positions.cols();i_poi++)
+  {
+    if(distance_field_)
+    {
+      if(i_poi == first_poi)
+        continue;
+
+      if(distance_field_->lowerBound(poi_positions.col(i_poi),lower_bound) && lower_bound>=min_distance)
+        continue;
+    }
+
+    distance = computePoiMinDistance(poi_positions.col(i_poi),i_obs);
+    if(distance<min_distance)
+    {
+      min_distance = distance;
+      min_poi = i_poi;
+      obs_idx = i_obs;
+    }
   }
 
-  res->poi_fk_              = poi_fk             ;
-  res->obstacle_            = obs_idx            ;
-  res->distance_            = min_distance       ;
-  res->robot_poi_           = poi_idx            ;
-  res->distance_vector_     = min_distance_vector;
-  res->robot_configuration_ = q                  ;
+  res.poi_fk_              = poi_positions.col(min_poi)                   ;
+  res.obstacle_            = obs_idx                                      ;
+  res.distance_            = min_distance                                 ;
+  res.robot_poi_           = poi_kinematics_.getPoiIdxs()[min_poi]        ;
+  res.distance_vector_     = obstacles_positions_.col(obs_idx)-res.poi_fk_; //in base
+  res.robot_configuration_ = q                                            ;
+}
 
-  return res;
+double MinDistanceSolver::computePoiMinDistance(const Eigen::Vector3d& poi_position, Eigen::Index& i_obs)
+{
+  double distance;
+
+  /* With many obstacles, search the closest one in the k-d tree */
+  if(obstacles_positions_.cols()>=obstacles_index_threshold_)
+  {
+    i_obs = obstacles_index_->nearest(poi_position,distance);
+    return distance;
+  }
+
+  double min_distance = std::numeric_limits<double>::infinity();
+  for(Eigen::Index i=0;i<obstacles_positions_.cols();i++)
+  {
+    distance = (obstacles_positions_.col(i)-poi_position).norm();
+    if(distance<min_distance)
+    {
+      min_distance = distance;
+      i_obs = i;
+    }
+  }
+
+  return min_distance;
 }
 
 MinDistanceSolverPtr MinDistanceSolver::clone()
 {
   MinDistanceSolverPtr clone = std::make_shared<MinDistanceSolver>(chain_->clone(),obstacles_positions_);
+  clone->setPoiNames(poi_names_);
+  clone->setObstaclesIndexThreshold(obstacles_index_threshold_);
   return clone;
 }
 
@@ -0,0 +1,160 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <min_distance_solvers/obstacles_index.h>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+
+namespace ssm15066_estimator
+{
+
+void ObstaclesIndex::build(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions)
+{
+  points_ = obstacles_positions;
+
+  idxs_.resize(points_.cols());
+  std::iota(idxs_.begin(),idxs_.end(),0);
+  split_dims_.assign(points_.cols(),0);
+
+  build(0,points_.cols());
+}
+
+void ObstaclesIndex::build(const Eigen::Index& begin, const Eigen::Index& end)
+{
+  if(end-begin<=leaf_size_)
+    return;
+
+  /* Split along the dimension of largest extent */
+  Eigen::Vector3d min_corner = points_.col(idxs_[begin]);
+  Eigen::Vector3d max_corner = min_corner;
+  for(Eigen::Index i=begin+1;i<end;i++)
+  {
+    min_corner = min_corner.cwiseMin(points_.col(idxs_[i]));
+    max_corner = max_corner.cwiseMax(points_.col(idxs_[i]));
+  }
+
+  Eigen::Index dim;
+  (max_corner-min_corner).maxCoeff(&dim);
+
+  Eigen::Index middle = begin+(end-begin)/2;
+  std::nth_element(idxs_.begin()+begin,idxs_.begin()+middle,idxs_.begin()+end,[&](const Eigen::Index& a, const Eigen::Index& b){
+    return points_(dim,a)<points_(dim,b);
+  });
+  split_dims_[middle] = dim;
+
+  build(begin,middle);
+  build(middle+1,end);
+}
+
+Eigen::Index ObstaclesIndex::nearest(const Eigen::Vector3d& point, double& distance) const
+{
+  Eigen::Index idx = -1;
+  double squared_distance = std::numeric_limits<double>::infinity();
+
+  nearest(0,points_.cols(),point,idx,squared_distance);
+
+  distance = std::sqrt(squared_distance);
+  return idx;
+}
+
+void ObstaclesIndex::nearest(const Eigen::Index& begin, const Eigen::Index& end, const Eigen::Vector3d& point, Eigen::Index& idx, double& squared_distance) const
+{
+  double this_squared_distance;
+  if(end-begin<=leaf_size_)
+  {
+    for(Eigen::Index i=begin;i<end;i++)
+    {
+      this_squared_distance = (points_.col(idxs_[i])-point).squaredNorm();
+      if(this_squared_distance<squared_distance || (this_squared_distance == squared_distance && idxs_[i]<idx))
+      {
+        squared_distance = this_squared_distance;
+        idx = idxs_[i];
+      }
+    }
+    return;
+  }
+
+  Eigen::Index middle = begin+(end-begin)/2;
+  this_squared_distance = (points_.col(idxs_[middle])-point).squaredNorm();
+  if(this_squared_distance<squared_distance || (this_squared_distance == squared_distance && idxs_[middle]<idx))
+  {
+    squared_distance = this_squared_distance;
+    idx = idxs_[middle];
+  }
+
+  double delta = point(split_dims_[middle])-points_(split_dims_[middle],idxs_[middle]);
+  if(delta<0.0)
+  {
+    nearest(begin,middle,point,idx,squared_distance);
+    if(delta*delta<=squared_distance)
+      nearest(middle+1,end,point,idx,squared_distance);
+  }
+  else
+  {
+    nearest(middle+1,end,point,idx,squared_distance);
+    if(delta*delta<=squared_distance)
+      nearest(begin,middle,point,idx,squared_distance);
+  }
+}
+
+void ObstaclesIndex::radiusSearch(const Eigen::Vector3d& point, const double& radius, std::vector<Eigen::Index>& idxs) const
+{
+  idxs.clear();
+  if(radius<0.0)
+    return;
+
+  radiusSearch(0,points_.cols(),point,radius*radius,idxs);
+  std::sort(idxs.begin(),idxs.end());
+}
+
+void ObstaclesIndex::radiusSearch(const Eigen::Index& begin, const Eigen::Index& end, const Eigen::Vector3d& point, const double& squared_radius,
+                                  std::vector<Eigen::Index>& idxs) const
+{
+  if(end-begin<=leaf_size_)
+  {
+    for(Eigen::Index i=begin;i<end;i++)
+    {
+      if((points_.col(idxs_[i])-point).squaredNorm()<=squared_radius)
+        idxs.push_back(idxs_[i]);
+    }
+    return;
+  }
+
+  Eigen::Index middle = begin+(end-begin)/2;
+  if((points_.col(idxs_[middle])-point).squaredNorm()<=squared_radius)
+    idxs.push_back(idxs_[middle]);
+
+  double delta = point(split_dims_[middle])-points_(split_dims_[middle],idxs_[middle]);
+  if(delta<=0.0 || delta*delta<=squared_radius)
+    radiusSearch(begin,middle,point,squared_radius,idxs);
+  if(delta>=0.0 || delta*delta<=squared_radius)
+    radiusSearch(middle+1,end,point,squared_radius,idxs);
+}
+
+}
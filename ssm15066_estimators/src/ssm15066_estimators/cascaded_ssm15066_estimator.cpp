@@ -0,0 +1,301 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <chrono>
+#include <ssm15066_estimators/cascaded_ssm15066_estimator.h>
+
+namespace ssm15066_estimator
+{
+
+CascadedSSM15066Estimator::CascadedSSM15066Estimator(const SSM15066Estimator2DPtr& estimator):
+  CostPenalty(), estimator_(estimator)
+{
+  updateBoundEstimator();
+  resetStatistics();
+}
+
+void CascadedSSM15066Estimator::updateBoundEstimator()
+{
+  ParallelSSM15066Estimator2DPtr parallel_estimator = std::dynamic_pointer_cast<ParallelSSM15066Estimator2D>(estimator_);
+  if(parallel_estimator)
+  {
+    /* The bounds run on the threads of the 2D estimator */
+    ParallelSSM15066Estimator1DPtr parallel_bound_estimator = std::make_shared<ParallelSSM15066Estimator1D>(estimator_->getChain()->clone(),
+                                                                                                            estimator_->getMaxStepSize(),
+                                                                                                            estimator_->getObstaclesPositions(),
+                                                                                                            parallel_estimator->getNumberOfThreads());
+    parallel_bound_estimator->setThreadPool(parallel_estimator->getScheduler()->getUsedPool());
+    bound_estimator_ = parallel_bound_estimator;
+  }
+  else
+    bound_estimator_ = std::make_shared<SSM15066Estimator1D>(estimator_->getChain()->clone(),estimator_->getMaxStepSize(),
+                                                             estimator_->getObstaclesPositions());
+
+  bound_estimator_->setPoiNames(estimator_->getPoiNames());
+  bound_estimator_->setObstaclesIndexThreshold(estimator_->getObstaclesIndexThreshold());
+
+  bound_estimator_->setMaxCartAcc(estimator_->getMaxCartAcc(),false);
+  bound_estimator_->setMinDistance(estimator_->getMinDistance(),false);
+  bound_estimator_->setReactionTime(estimator_->getReactionTime(),false);
+  bound_estimator_->setHumanVelocity(estimator_->getHumanVelocity(),false);
+
+  bound_estimator_->updateMembers();
+
+  /* The 1D scaling factor of each sample must bound the 2D one, so slow pois are not neglected.
+   * The skipped samples and the connections accepted without sampling have a scaling factor of 1.0 for sure */
+  bound_estimator_->setMinPoiSpeed(0.0);
+  bound_estimator_->setAdaptiveSampling(true,0.0);
+  bound_estimator_->setQuickAccept(true);
+  bound_estimator_->setVerbose(verbose_);
+
+  boundEstimatorUpdated();
+}
+
+void CascadedSSM15066Estimator::boundEstimatorUpdated()
+{
+  estimator_scene_version_ = estimator_->getSceneVersion();
+  increaseSceneVersion();
+}
+
+void CascadedSSM15066Estimator::setPoiNames(const std::vector<std::string> poi_names)
+{
+  estimator_->setPoiNames(poi_names);
+  bound_estimator_->setPoiNames(estimator_->getPoiNames());
+  boundEstimatorUpdated();
+}
+
+void CascadedSSM15066Estimator::setObstaclesPositions(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions)
+{
+  estimator_->setObstaclesPositions(obstacles_positions);
+  bound_estimator_->setObstaclesPositions(obstacles_positions);
+  boundEstimatorUpdated();
+}
+
+void CascadedSSM15066Estimator::addObstaclePosition(const Eigen::Vector3d& obstacle_position)
+{
+  estimator_->addObstaclePosition(obstacle_position);
+  bound_estimator_->addObstaclePosition(obstacle_position);
+  boundEstimatorUpdated();
+}
+
+void CascadedSSM15066Estimator::clearObstaclesPositions()
+{
+  estimator_->clearObstaclesPositions();
+  bound_estimator_->clearObstaclesPositions();
+  boundEstimatorUpdated();
+}
+
+void CascadedSSM15066Estimator::setObstaclesIndexThreshold(const unsigned int& threshold)
+{
+  estimator_->setObstaclesIndexThreshold(threshold);
+  bound_estimator_->setObstaclesIndexThreshold(threshold);
+  boundEstimatorUpdated();
+}
+
+void CascadedSSM15066Estimator::setMaxStepSize(const double& max_step_size)
+{
+  estimator_->setMaxStepSize(max_step_size);
+  bound_estimator_->setMaxStepSize(max_step_size);
+  boundEstimatorUpdated();
+}
+
+void CascadedSSM15066Estimator::setMaxCartAcc(const double& max_cart_acc)
+{
+  estimator_->setMaxCartAcc(max_cart_acc);
+  bound_estimator_->setMaxCartAcc(max_cart_acc);
+  boundEstimatorUpdated();
+}
+
+void CascadedSSM15066Estimator::setMinDistance(const double& min_distance)
+{
+  estimator_->setMinDistance(min_distance);
+  bound_estimator_->setMinDistance(min_distance);
+  boundEstimatorUpdated();
+}
+
+void CascadedSSM15066Estimator::setReactionTime(const double& reaction_time)
+{
+  estimator_->setReactionTime(reaction_time);
+  bound_estimator_->setReactionTime(reaction_time);
+  boundEstimatorUpdated();
+}
+
+void CascadedSSM15066Estimator::setHumanVelocity(const double& human_velocity)
+{
+  estimator_->setHumanVelocity(human_velocity);
+  bound_estimator_->setHumanVelocity(human_velocity);
+  boundEstimatorUpdated();
+}
+
+void CascadedSSM15066Estimator::setVerbose(const unsigned int& verbose)
+{
+  verbose_ = verbose;
+  estimator_->setVerbose(verbose);
+  bound_estimator_->setVerbose(verbose);
+}
+
+double CascadedSSM15066Estimator::getEstimatedSpeedup()
+{
+  unsigned long estimated_connections = connections_-bound_accepts_;
+  double bound_time = getBoundTime();
+  double estimator_time = getEstimatorTime();
+  if(estimated_connections == 0 || bound_time+estimator_time<=0.0)
+    return 1.0;
+
+  double estimator_only_time = estimator_time*((double) connections_)/((double) estimated_connections);
+  return estimator_only_time/(bound_time+estimator_time);
+}
+
+void CascadedSSM15066Estimator::resetStatistics()
+{
+  connections_ = 0;
+  bound_accepts_ = 0;
+  bound_time_ = 0;
+  estimator_time_ = 0;
+}
+
+bool CascadedSSM15066Estimator::useBound()
+{
+  if(estimator_->getSceneVersion() != estimator_scene_version_)  // estimator_ changed directly
+    updateBoundEstimator();
+
+  /* The quadrature nodes are not samples of the uniform sampling, where the 1D scaling factor bounds the 2D one */
+  return not estimator_->getQuadrature();
+}
+
+bool CascadedSSM15066Estimator::isBoundedToOne(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  if(not useBound())
+  {
+    connections_++;
+    return false;
+  }
+
+  std::chrono::steady_clock::time_point tic = std::chrono::steady_clock::now();
+
+  /* The 1D evaluation stops at the first sample with a scaling factor higher than 1.0 */
+  bool bounded_to_one = (bound_estimator_->computeScalingFactorBounded(q1,q2,1.0) == 1.0);
+
+  bound_time_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-tic).count();
+  connections_++;
+
+  if(bounded_to_one)
+  {
+    bound_accepts_++;
+
+    if(verbose_>0)
+      ROS_ERROR_STREAM("1D scaling factor 1.0, 2D estimation not needed");
+  }
+
+  return bounded_to_one;
+}
+
+double CascadedSSM15066Estimator::computePenalty(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  if(isBoundedToOne(q1,q2))
+    return 1.0;
+
+  std::chrono::steady_clock::time_point tic = std::chrono::steady_clock::now();
+  double scaling_factor = estimator_->computeScalingFactor(q1,q2);
+  estimator_time_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-tic).count();
+
+  return scaling_factor;
+}
+
+double CascadedSSM15066Estimator::computePenaltyBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_penalty)
+{
+  if(isBoundedToOne(q1,q2))
+    return 1.0;
+
+  std::chrono::steady_clock::time_point tic = std::chrono::steady_clock::now();
+  double scaling_factor = estimator_->computeScalingFactorBounded(q1,q2,max_penalty);
+  estimator_time_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-tic).count();
+
+  return scaling_factor;
+}
+
+std::vector<double> CascadedSSM15066Estimator::computePenalties(const pathplan::ConfigurationsPairs& connections)
+{
+  std::vector<double> penalties(connections.size(),1.0);
+  connections_ += connections.size();
+
+  if(not useBound())
+  {
+    std::chrono::steady_clock::time_point tic = std::chrono::steady_clock::now();
+    penalties = estimator_->computeScalingFactors(connections);
+    estimator_time_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-tic).count();
+
+    return penalties;
+  }
+
+  /* The bounds are evaluated as a single batch, in parallel if bound_estimator_ is a ParallelSSM15066Estimator1D */
+  std::chrono::steady_clock::time_point tic = std::chrono::steady_clock::now();
+  std::vector<double> bounds = bound_estimator_->computeScalingFactorsBounded(connections,1.0);
+  bound_time_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-tic).count();
+
+  /* The connections not bounded to 1.0 are evaluated by the 2D estimator as a single batch */
+  std::vector<size_t> idxs;
+  pathplan::ConfigurationsPairs connections_to_estimate;
+  for(size_t idx=0;idx<connections.size();idx++)
+  {
+    if(bounds[idx] == 1.0)
+    {
+      bound_accepts_++;
+
+      if(verbose_>0)
+        ROS_ERROR_STREAM("1D scaling factor 1.0, 2D estimation not needed");
+    }
+    else
+    {
+      idxs.push_back(idx);
+      connections_to_estimate.push_back(connections[idx]);
+    }
+  }
+
+  if(connections_to_estimate.empty())
+    return penalties;
+
+  tic = std::chrono::steady_clock::now();
+  std::vector<double> scaling_factors = estimator_->computeScalingFactors(connections_to_estimate);
+  estimator_time_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-tic).count();
+
+  for(size_t i=0;i<idxs.size();i++)
+    penalties[idxs[i]] = scaling_factors[i];
+
+  return penalties;
+}
+
+pathplan::CostPenaltyPtr CascadedSSM15066Estimator::clone()
+{
+  SSM15066Estimator2DPtr cloned_estimator = std::static_pointer_cast<SSM15066Estimator2D>(estimator_->clone());
+  pathplan::CostPenaltyPtr clone = std::make_shared<CascadedSSM15066Estimator>(cloned_estimator);
+
+  return clone;
+}
+
+}
@@ -0,0 +1,113 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <ssm15066_estimators/edge_kinematics.h>
+
+namespace ssm15066_estimator
+{
+EdgeKinematicsStore::EdgeKinematicsStore(const size_t& capacity, const double& resolution):
+  capacity_(capacity),resolution_(resolution)
+{
+  if(capacity_ == 0)
+  {
+    ROS_ERROR("store capacity must be positive, set equal to 1");
+    capacity_ = 1;
+  }
+
+  if(resolution_<=0.0)
+  {
+    ROS_ERROR("store resolution must be positive, set equal to 1e-06");
+    resolution_ = 1e-06;
+  }
+
+  store_.reserve(capacity_);
+}
+
+EdgeKinematicsPtr EdgeKinematicsStore::find(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  pathplan::ConnectionKey key(q1,q2,resolution_,0);
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = store_.find(key);
+  if(it == store_.end())
+    return nullptr;
+
+  entries_.splice(entries_.begin(),entries_,it->second);  // move it in front, iterators stay valid
+  return it->second->second;
+}
+
+void EdgeKinematicsStore::insert(const EdgeKinematicsPtr& kinematics)
+{
+  pathplan::ConnectionKey key(kinematics->q1_,kinematics->q2_,resolution_,0);
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = store_.find(key);
+  if(it != store_.end())
+  {
+    it->second->second = kinematics;
+    entries_.splice(entries_.begin(),entries_,it->second);
+    return;
+  }
+
+  if(store_.size()>=capacity_)
+  {
+    store_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+
+  entries_.emplace_front(key,kinematics);
+  store_.emplace(std::move(key),entries_.begin());
+}
+
+void EdgeKinematicsStore::erase(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  pathplan::ConnectionKey key(q1,q2,resolution_,0);
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = store_.find(key);
+  if(it == store_.end())
+    return;
+
+  entries_.erase(it->second);
+  store_.erase(it);
+}
+
+void EdgeKinematicsStore::clear()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  store_.clear();
+  entries_.clear();
+}
+
+size_t EdgeKinematicsStore::size()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return store_.size();
+}
+
+}
@@ -0,0 +1,323 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <ssm15066_estimators/parallel_ssm15066_estimator1D.h>
+
+namespace ssm15066_estimator
+{
+
+ParallelSSM15066Estimator1D::ParallelSSM15066Estimator1D(const rosdyn::ChainPtr &chain, const unsigned int& n_threads):
+  SSM15066Estimator1D(chain),n_threads_(n_threads){init();}
+
+ParallelSSM15066Estimator1D::ParallelSSM15066Estimator1D(const rosdyn::ChainPtr &chain, const double& max_step_size,
+                                                         const unsigned int& n_threads):
+  SSM15066Estimator1D(chain,max_step_size),n_threads_(n_threads){init();}
+
+ParallelSSM15066Estimator1D::ParallelSSM15066Estimator1D(const rosdyn::ChainPtr &chain, const double& max_step_size,
+                                                         const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions,
+                                                         const unsigned int& n_threads):
+  SSM15066Estimator1D(chain,max_step_size,obstacles_positions),n_threads_(n_threads){init();}
+
+void ParallelSSM15066Estimator1D::init()
+{
+  verbose_ = 0;
+
+  scheduler_ = std::make_shared<SampleScheduler>(n_threads_);
+  n_threads_ = scheduler_->getNumberOfThreads();
+
+  /* The resources of the threads are created at the first parallel evaluation, so that cloning is cheap */
+  chains_.clear();
+  min_distance_solvers_.clear();
+  workspaces_.clear();
+}
+
+void ParallelSSM15066Estimator1D::initThreadsResources()
+{
+  if(chains_.size() == n_threads_)
+    return;
+
+  chains_.resize(n_threads_);
+  min_distance_solvers_.resize(n_threads_);
+  workspaces_.resize(n_threads_);
+
+  /* The solvers get the current obstacles from min_distance_solver_, the setters keep them updated afterwards */
+  for(unsigned int i=0;i<n_threads_;i++)
+  {
+    chains_[i] = chain_->clone();
+
+    min_distance_solvers_[i] = min_distance_solver_->clone();
+    if(min_distance_solver_->getDistanceField())
+      min_distance_solvers_[i]->setDistanceField(min_distance_solver_->getDistanceField(),false);
+  }
+}
+
+void ParallelSSM15066Estimator1D::setThreadPool(const ThreadPoolPtr& pool)
+{
+  SampleSchedulerPtr scheduler = std::make_shared<SampleScheduler>(n_threads_,pool);
+  scheduler->setChunkSize(scheduler_->getChunkSize());
+  scheduler->setMinSamplesToParallelize(scheduler_->getMinSamplesToParallelize());
+  scheduler->setMaxTasksInFlight(scheduler_->getMaxTasksInFlight());
+
+  scheduler_->waitForTasks();
+  scheduler_ = scheduler;
+}
+
+void ParallelSSM15066Estimator1D::updatePoiIdxs()
+{
+  SSM15066Estimator1D::updatePoiIdxs();
+  for(const MinDistanceSolverPtr& solver: min_distance_solvers_)
+    solver->setPoiNames(min_distance_solver_->getPoiNames());
+}
+
+void ParallelSSM15066Estimator1D::addObstaclePosition(const Eigen::Vector3d& obstacle_position)
+{
+  SSM15066Estimator1D::addObstaclePosition(obstacle_position);
+  for(const MinDistanceSolverPtr& solver: min_distance_solvers_)
+    solver->addObstaclePosition(obstacle_position);
+}
+
+void ParallelSSM15066Estimator1D::setObstaclesPositions(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions)
+{
+  SSM15066Estimator1D::setObstaclesPositions(obstacles_positions);
+  for(const MinDistanceSolverPtr& solver: min_distance_solvers_)
+    solver->setObstaclesPositions(obstacles_positions);
+}
+
+void ParallelSSM15066Estimator1D::clearObstaclesPositions()
+{
+  SSM15066Estimator1D::clearObstaclesPositions();
+  for(const MinDistanceSolverPtr& solver: min_distance_solvers_)
+    solver->clearObstaclesPositions();
+}
+
+void ParallelSSM15066Estimator1D::setObstaclesIndexThreshold(const unsigned int& threshold)
+{
+  SSM15066Estimator1D::setObstaclesIndexThreshold(threshold);
+  for(const MinDistanceSolverPtr& solver: min_distance_solvers_)
+    solver->setObstaclesIndexThreshold(threshold);
+}
+
+void ParallelSSM15066Estimator1D::setDistanceField(const Eigen::Vector3d& min_corner, const Eigen::Vector3d& max_corner, const double& resolution)
+{
+  /* The field is built and updated by min_distance_solver_ only, the solvers of the threads share it */
+  SSM15066Estimator1D::setDistanceField(min_corner,max_corner,resolution);
+  for(const MinDistanceSolverPtr& solver: min_distance_solvers_)
+    solver->setDistanceField(min_distance_solver_->getDistanceField(),false);
+}
+
+void ParallelSSM15066Estimator1D::disableDistanceField()
+{
+  SSM15066Estimator1D::disableDistanceField();
+  for(const MinDistanceSolverPtr& solver: min_distance_solvers_)
+    solver->setDistanceField(nullptr);
+}
+
+double ParallelSSM15066Estimator1D::computeScalingFactorParallel(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor)
+{
+  Eigen::VectorXd& dq = workspace_.dq;
+  Eigen::VectorXd& delta_q = workspace_.delta_q;
+  Eigen::VectorXd& connection_vector = workspace_.connection_vector;
+
+  connection_vector = q2-q1;
+  unsigned int iter = std::max(std::ceil(connection_vector.norm()/max_step_size_),1.0);
+
+  /* Short connections are evaluated by the calling thread, as well as integrated ones since the samples depend on the previous ones */
+  if(not scheduler_->isParallel(iter+1) || quadrature_)
+    return SSM15066Estimator1D::computeScalingFactor(chain_,min_distance_solver_,workspace_,q1,q2,max_scaling_factor);
+
+  if(quick_accept_ && isFarFromObstacles(chain_,workspace_,q1,q2,true))
+    return 1.0;
+
+  /* Compute the time of each joint to move from q1 to q2 at its maximum speed and consider the longest time
+   * The "slowest" joint will move at its highest speed while the other ones will
+   * move at (t_i/slowest_joint_time)*max_speed_i, where slowest_joint_time >= t_i */
+  double slowest_joint_time = (inv_max_speed_.cwiseProduct(connection_vector)).cwiseAbs().maxCoeff();
+  dq = connection_vector/slowest_joint_time;
+  delta_q = connection_vector/iter;
+
+  /* Each sample is generated on the fly as q1+i*delta_q, in the workspace of the thread. Few captures, so that the std::function does not allocate */
+  SampleScheduler::SampleFunction sample_function = [this,&q1](const unsigned int& thread, const unsigned int& i) ->double{
+    double min_distance;
+    Workspace& workspace = workspaces_[thread];
+    workspace.q = q1+i*workspace_.delta_q;
+
+    return computeScalingFactorAtQ(chains_[thread],min_distance_solvers_[thread],workspace,workspace.q,workspace_.dq,min_distance);
+  };
+
+  initThreadsResources();
+  double scaling_factor = scheduler_->computeAverage(iter+1,sample_function,max_scaling_factor);
+
+  assert([&]() ->bool{
+           if(scaling_factor>=1.0)
+           {
+             return true;
+           }
+           else
+           {
+             ROS_INFO_STREAM("Scaling factor "<<scaling_factor<<" samples "<<iter+1);
+             return false;
+           }
+         }());
+
+  return scaling_factor;
+}
+
+double ParallelSSM15066Estimator1D::computeScalingFactor(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  return computeScalingFactorBounded(q1,q2,std::numeric_limits<double>::infinity());
+}
+
+double ParallelSSM15066Estimator1D::computeScalingFactorBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor)
+{
+  assert(obstacles_positions_ == min_distance_solver_->getObstaclesPositions());
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return 1.0;
+
+  if(kinematics_store_)  // the samples of a connection missing from the store are computed in parallel, see computeEdgeKinematics
+    return SSM15066Estimator1D::computeScalingFactorBounded(q1,q2,max_scaling_factor);
+
+  return computeScalingFactorParallel(q1,q2,max_scaling_factor);
+}
+
+std::vector<double> ParallelSSM15066Estimator1D::computeScalingFactors(const pathplan::ConfigurationsPairs& connections)
+{
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return std::vector<double>(connections.size(),1.0);
+
+  if(connections.size()<n_threads_)
+    return SSM15066Estimator::computeScalingFactors(connections);
+
+  initThreadsResources();
+
+  /* Each thread takes the next connection to evaluate until all of them have been processed,
+   * so that long and short connections are balanced among the threads */
+  std::vector<double> scaling_factors(connections.size());
+  scheduler_->forEach(connections.size(),[this,&connections,&scaling_factors](const unsigned int& thread, const size_t& idx) ->void{
+    if(kinematics_store_)
+      scaling_factors[idx] = computeScalingFactorFromKinematics(*getEdgeKinematics(chains_[thread],workspaces_[thread],connections[idx].first,connections[idx].second));
+    else
+      scaling_factors[idx] = SSM15066Estimator1D::computeScalingFactor(chains_[thread],min_distance_solvers_[thread],workspaces_[thread],
+                                                                       connections[idx].first,connections[idx].second);
+  });
+
+  return scaling_factors;
+}
+
+std::vector<double> ParallelSSM15066Estimator1D::computeScalingFactorsBounded(const pathplan::ConfigurationsPairs& connections,
+                                                                          const double& max_scaling_factor)
+{
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return std::vector<double>(connections.size(),1.0);
+
+  if(connections.size()<n_threads_)
+    return SSM15066Estimator::computeScalingFactorsBounded(connections,max_scaling_factor);
+
+  initThreadsResources();
+
+  std::vector<double> scaling_factors(connections.size());
+  scheduler_->forEach(connections.size(),[this,&connections,&scaling_factors,&max_scaling_factor](const unsigned int& thread, const size_t& idx) ->void{
+    if(kinematics_store_)
+      scaling_factors[idx] = computeScalingFactorFromKinematics(*getEdgeKinematics(chains_[thread],workspaces_[thread],connections[idx].first,connections[idx].second));
+    else
+      scaling_factors[idx] = SSM15066Estimator1D::computeScalingFactor(chains_[thread],min_distance_solvers_[thread],workspaces_[thread],
+                                                                       connections[idx].first,connections[idx].second,max_scaling_factor);
+  });
+
+  return scaling_factors;
+}
+
+std::vector<double> ParallelSSM15066Estimator1D::computePathScalingFactors(const pathplan::Waypoints& waypoints)
+{
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return std::vector<double>(std::max(waypoints.size(),(size_t) 1)-1,1.0);
+
+  if(kinematics_store_ || adaptive_sampling_ || quick_accept_ || quadrature_)
+    return SSM15066Estimator::computePathScalingFactors(waypoints);
+
+  std::vector<unsigned int> n_samples;
+  std::vector<Eigen::VectorXd> dqs, delta_qs;
+  computePathSampling(waypoints,dqs,delta_qs,n_samples);
+
+  initThreadsResources();
+  return scheduler_->computeAverages(n_samples,[this,&waypoints,&dqs,&delta_qs](const unsigned int& thread, const size_t& connection,
+                                     const unsigned int& i) ->double{
+    double min_distance;
+    Workspace& workspace = workspaces_[thread];
+    workspace.q = waypoints[connection]+i*delta_qs[connection];
+
+    return computeScalingFactorAtQ(chains_[thread],min_distance_solvers_[thread],workspace,workspace.q,dqs[connection],min_distance);
+  });
+}
+
+EdgeKinematicsPtr ParallelSSM15066Estimator1D::computeEdgeKinematics(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  EdgeKinematicsPtr kinematics = createEdgeKinematics(q1,q2);
+
+  unsigned int n_samples = kinematics->n_samples_;
+  if(not scheduler_->isParallel(n_samples))
+  {
+    computeEdgeKinematicsSamples(chain_,workspace_,*kinematics,0,n_samples);
+    return kinematics;
+  }
+
+  initThreadsResources();
+
+  /* Each thread computes chunks of consecutive samples, in disjoint columns of kinematics */
+  unsigned int chunk_size = scheduler_->getChunkSize();
+  scheduler_->forEach((n_samples+chunk_size-1)/chunk_size,[this,&kinematics,&n_samples,&chunk_size](const unsigned int& thread, const size_t& chunk) ->void{
+    unsigned int first = chunk*chunk_size;
+    computeEdgeKinematicsSamples(chains_[thread],workspaces_[thread],*kinematics,first,std::min(first+chunk_size,n_samples));
+  });
+
+  return kinematics;
+}
+
+void ParallelSSM15066Estimator1D::copySettingsTo(SSM15066Estimator& other)
+{
+  SSM15066Estimator1D::copySettingsTo(other);
+
+  ParallelSSM15066Estimator1D& other_parallel = static_cast<ParallelSSM15066Estimator1D&>(other);
+  if(scheduler_->getThreadPool())
+    other_parallel.setThreadPool(scheduler_->getThreadPool());
+
+  other_parallel.setChunkSize(scheduler_->getChunkSize());
+  other_parallel.setMinSamplesToParallelize(scheduler_->getMinSamplesToParallelize());
+  other_parallel.scheduler_->setMaxTasksInFlight(scheduler_->getMaxTasksInFlight());
+}
+
+pathplan::CostPenaltyPtr ParallelSSM15066Estimator1D::clone()
+{
+  ParallelSSM15066Estimator1DPtr cloned_ssm = std::make_shared<ParallelSSM15066Estimator1D>(chain_->clone(),max_step_size_,obstacles_positions_,n_threads_);
+  copySettingsTo(*cloned_ssm);
+
+  pathplan::CostPenaltyPtr clone = cloned_ssm;
+
+  return clone;
+}
+
+}
@@ -47,124 +47,135 @@ ParallelSSM15066Estimator2D::ParallelSSM15066Estimator2D(const rosdyn::ChainPtr
 void ParallelSSM15066Estimator2D::init()
 {
   verbose_ = 0;
-  stop_ = true;
-  running_threads_ = 0;
 
-  if(n_threads_<=0)
-    n_threads_ = std::thread::hardware_concurrency();
-  else if(n_threads_>std::thread::hardware_concurrency())
-  {
-    ROS_ERROR_STREAM("number of threads ("<<n_threads_<<") should not be higher than hardware max concurrency ("<<std::thread::hardware_concurrency()<<")");
-    n_threads_ = std::thread::hardware_concurrency();
-  }
+  scheduler_ = std::make_shared<SampleScheduler>(n_threads_);
+  n_threads_ = scheduler_->getNumberOfThreads();
+
+  /* The resources of the threads are created at the first parallel evaluation, so that cloning is cheap */
+  chains_.clear();
+  workspaces_.clear();
+}
 
-  queues_ .clear();
-  chains_ .clear();
-  futures_.clear();
+void ParallelSSM15066Estimator2D::initThreadsResources()
+{
+  if(chains_.size() == n_threads_)
+    return;
 
-  chains_ .resize(n_threads_);
-  queues_ .resize(n_threads_);
-  futures_.resize(n_threads_);
+  chains_.resize(n_threads_);
+  workspaces_.resize(n_threads_);
 
   for(unsigned int i=0;i<n_threads_;i++)
-  {
     chains_[i] = chain_->clone();
-    queues_[i] = std::make_shared<Queue>();
-  }
+}
 
-  pool_ = std::make_shared<BS::thread_pool>(n_threads_);
+void ParallelSSM15066Estimator2D::setThreadPool(const ThreadPoolPtr& pool)
+{
+  SampleSchedulerPtr scheduler = std::make_shared<SampleScheduler>(n_threads_,pool);
+  scheduler->setChunkSize(scheduler_->getChunkSize());
+  scheduler->setMinSamplesToParallelize(scheduler_->getMinSamplesToParallelize());
+  scheduler->setMaxTasksInFlight(scheduler_->getMaxTasksInFlight());
+
+  scheduler_->waitForTasks();
+  scheduler_ = scheduler;
 }
 
-void ParallelSSM15066Estimator2D::resetQueues()
+ParallelSSM15066Estimator2D::~ParallelSSM15066Estimator2D()
 {
-  stop_ = true;
+  /* The submitted connections refer to the estimator */
+  scheduler_->waitForTasks();
+}
 
-  pool_->wait_for_tasks();
-  assert(pool_->get_tasks_total  () == 0);
-  assert(pool_->get_tasks_queued () == 0);
-  assert(pool_->get_tasks_running() == 0);
+std::future<double> ParallelSSM15066Estimator2D::computePenaltyAsync(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                                                                    const pathplan::PenaltyCallback& callback)
+{
+  if(obstacles_positions_.cols()==0)  // nothing to evaluate
+    return SSM15066Estimator2D::computePenaltyAsync(q1,q2,callback);
 
-  for(const QueuePtr& queue:queues_)
-    queue->reset();
+  if(async_chains_.size() != scheduler_->getMaxTasksInFlight())
+  {
+    scheduler_->waitForTasks();
 
-  running_threads_ = 0;
+    async_chains_.resize(scheduler_->getMaxTasksInFlight());
+    async_workspaces_.resize(scheduler_->getMaxTasksInFlight());
 
-  assert([&]() ->bool{
-           for(const QueuePtr& queue:queues_)
-           {
-             if(not queue->queue_.empty())
-             return false;
-           }
-           return true;
-         }());
+    for(rosdyn::ChainPtr& chain: async_chains_)
+    {
+      if(not chain)
+        chain = chain_->clone();
+    }
+  }
+
+  return scheduler_->submit([this,q1,q2,callback](const unsigned int& slot) ->double{
+    double scaling_factor;
+    if(kinematics_store_)
+      scaling_factor = computeScalingFactorFromKinematics(async_workspaces_[slot],*getEdgeKinematics(async_chains_[slot],async_workspaces_[slot],q1,q2));
+    else
+      scaling_factor = SSM15066Estimator2D::computeScalingFactor(async_chains_[slot],async_workspaces_[slot],q1,q2);
+
+    if(callback)
+      callback(scaling_factor);
+
+    return scaling_factor;
+  });
 }
 
-unsigned int ParallelSSM15066Estimator2D::fillQueues(const Eigen::VectorXd& q1, const Eigen::VectorXd q2)
+double ParallelSSM15066Estimator2D::computeScalingFactorParallel(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor)
 {
-  unsigned int n_addends = 0;
-  unsigned int thread_iter = 0;
+  Eigen::VectorXd& dq = workspace_.dq;
+  Eigen::VectorXd& delta_q = workspace_.delta_q;
+  Eigen::VectorXd& connection_vector = workspace_.connection_vector;
 
-  Eigen::VectorXd connection_vector = q2-q1;
+  connection_vector = q2-q1;
   unsigned int iter = std::max(std::ceil(connection_vector.norm()/max_step_size_),1.0);
 
-  Eigen::VectorXd q;
-  Eigen::VectorXd delta_q = connection_vector/iter;
+  /* Short connections are evaluated by the calling thread, as well as interpolated and integrated ones since the samples depend on the previous ones */
+  if(not scheduler_->isParallel(iter+1) || kinematics_interpolation_ || quadrature_)
+    return SSM15066Estimator2D::computeScalingFactor(chain_,workspace_,q1,q2,max_scaling_factor);
 
-  assert([&]() ->bool{
-           for(const QueuePtr& queue: queues_)
-           {
-             if(not queue->queue_.empty())
-             return false;
-           }
+  if(quick_accept_ && isFarFromObstacles(chain_,workspace_,q1,q2,false))
+    return 1.0;
 
-           return true;
-         }());
+  /* Compute the time of each joint to move from q1 to q2 at its maximum speed and consider the longest time
+   * The "slowest" joint will move at its highest speed while the other ones will
+   * move at (t_i/slowest_joint_time)*max_speed_i, where slowest_joint_time >= t_i */
+  double slowest_joint_time = (inv_max_speed_.cwiseProduct(connection_vector)).cwiseAbs().maxCoeff();
+  dq = connection_vector/slowest_joint_time;
+  delta_q = connection_vector/iter;
 
-  for(unsigned int i=0;i<iter+1;i++)
-  {
-    q = q1+i*delta_q;
+  if(verbose_>0)
+    ROS_ERROR_STREAM("joint velocity "<<dq.norm());
 
-    if(thread_iter>=n_threads_)
-      thread_iter = 0;
+  initThreadsResources();
 
-    queues_[thread_iter]->insert(q);
+  /* Each sample is generated on the fly as q1+i*delta_q, in the workspace of the thread. Few captures, so that the std::function does not allocate */
+  SampleScheduler::SampleFunction sample_function = [this,&q1](const unsigned int& thread, const unsigned int& i) ->double{
+    Workspace& workspace = workspaces_[thread];
+    workspace.q = q1+i*workspace_.delta_q;
 
-    n_addends++;
-    thread_iter++;
-  }
+    computePoiKinematics(chains_[thread],workspace.q,workspace_.dq,workspace.poi_positions,workspace.poi_velocities);
+    double max_scaling_factor_of_q = computeMaxScalingFactorAtPois(workspace.poi_positions,workspace.poi_velocities,workspace.obstacles_idxs);
+
+    if(verbose_>0)
+      ROS_INFO_STREAM("q "<<workspace.q.transpose()<<" -> scaling factor: "<<max_scaling_factor_of_q);
+
+    return max_scaling_factor_of_q;
+  };
+
+  double scaling_factor = scheduler_->computeAverage(iter+1,sample_function,max_scaling_factor);
 
   assert([&]() ->bool{
-           double diff = (q2-q).norm();
-           if(diff<1e-08)
+           if(scaling_factor>=1.0)
            {
              return true;
            }
            else
            {
-             ROS_INFO_STREAM("Diff "<<diff);
-             ROS_INFO_STREAM("q "<<q.transpose()<<"\nq2 "<<q2.transpose());
-             ROS_INFO_STREAM("iter "<<iter);
-             ROS_INFO_STREAM("iter+1 "<<(iter+1)<<" delta_q "<<delta_q.transpose()<<" product "<<((iter+1)*delta_q).transpose());
+             ROS_INFO_STREAM("Scaling factor "<<scaling_factor<<" samples "<<iter+1);
              return false;
            }
          }());
 
-  if(n_addends>n_threads_)
-    running_threads_ = n_threads_;
-  else
-    running_threads_ = n_addends;
-
-  if(verbose_>0)
-  {
-    for(unsigned int i=0;i<queues_.size();i++)
-    {
-      ROS_WARN_STREAM("QUEUE "<<i);
-      for(const Eigen::VectorXd& q:queues_[i]->queue_)
-        ROS_INFO_STREAM(q.transpose());
-    }
-  }
-
-  return n_addends;
+  return scaling_factor;
 }
 
 double ParallelSSM15066Estimator2D::computeScalingFactor(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
@@ -172,9 +183,6 @@ double ParallelSSM15066Estimator2D::computeScalingFactor(const Eigen::VectorXd&
   if(verbose_>0)
     ROS_WARN("--------");
 
-  ros::WallTime tic, tic_init, toc;
-  double time_tot, time_reset, time_fill, time_thread, time_join;
-
   if(obstacles_positions_.cols()==0)  //no obstacles in the scene
   {
     if(verbose_>0)
@@ -190,216 +198,165 @@ double ParallelSSM15066Estimator2D::computeScalingFactor(const Eigen::VectorXd&
       ROS_ERROR_STREAM("obs location -> "<<obstacles_positions_.col(i).transpose());
   }
 
-  tic_init = ros::WallTime::now();
-  tic = ros::WallTime::now();
-  resetQueues();
-  toc = ros::WallTime::now();
-  time_reset = (toc-tic).toSec();
+  if(kinematics_store_)  // the samples of a connection missing from the store are computed in parallel, see computeEdgeKinematics
+    return SSM15066Estimator2D::computeScalingFactor(q1,q2);
 
-  tic = ros::WallTime::now();
-  unsigned int n_addends = fillQueues(q1,q2);
-  toc = ros::WallTime::now();
-  time_fill = (toc-tic).toSec();
+  double scaling_factor = computeScalingFactorParallel(q1,q2);
 
-  if(n_addends == 0)
-  {
-    if(verbose_>0)
-      ROS_ERROR("--------");
+  if(verbose_>0)
+    ROS_ERROR("--------");
+
+  return scaling_factor;
+}
 
+double ParallelSSM15066Estimator2D::computeScalingFactorBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor)
+{
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
     return 1.0;
-  }
 
-  /* Compute the time of each joint to move from q1 to q2 at its maximum speed and consider the longest time
-   * The "slowest" joint will move at its highest speed while the other ones will
-   * move at (t_i/slowest_joint_time)*max_speed_i, where slowest_joint_time >= t_i */
-  Eigen::VectorXd connection_vector = q2-q1;
-  double slowest_joint_time = (inv_max_speed_.cwiseProduct(q2 - q1)).cwiseAbs().maxCoeff();
-  dq_max_ = connection_vector/slowest_joint_time;
+  if(kinematics_store_)
+    return SSM15066Estimator2D::computeScalingFactorBounded(q1,q2,max_scaling_factor);
 
-  assert([&]() ->bool{
-           Eigen::VectorXd q_v  = connection_vector/connection_vector.norm();
-           Eigen::VectorXd dq_v = dq_max_/dq_max_.norm();
+  return computeScalingFactorParallel(q1,q2,max_scaling_factor);
+}
 
-           double err = (q_v-dq_v).norm();
-           if(err<1e-08)
-           {
-             return true;
-           }
-           else
-           {
-             ROS_ERROR_STREAM("q_v "<<q_v.transpose()<<" dq_v "<<dq_v.transpose()<<" err "<<err<<" slowest time "<<slowest_joint_time);
-             ROS_ERROR_STREAM("q1 "<<q1.transpose()<<" q2 "<<q2.transpose()<<" dq_inv "<<inv_max_speed_.transpose());
+std::pair<double,double> ParallelSSM15066Estimator2D::computeScalingFactorBothWays(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return std::make_pair(1.0,1.0);
 
-             return false;
-           }
-         }());
+  if(kinematics_store_)
+    return SSM15066Estimator2D::computeScalingFactorBothWays(q1,q2);
 
-  if(verbose_>0)
-    ROS_ERROR_STREAM("joint velocity "<<dq_max_.norm());
+  unsigned int iter = std::max(std::ceil((q2-q1).norm()/max_step_size_),1.0);
 
-  stop_ = false; //must be after resetQueues()
+  if(not scheduler_->isParallel(iter+1) || kinematics_interpolation_ || quadrature_)
+    return SSM15066Estimator2D::computeScalingFactorBothWays(chain_,workspace_,q1,q2);
 
-  tic = ros::WallTime::now();
-  for(unsigned int i=0;i<running_threads_;i++)
-    futures_[i]= pool_->submit(&ParallelSSM15066Estimator2D::computeScalingFactorAsync,this,i);
-  toc = ros::WallTime::now();
-  time_thread = (toc-tic).toSec();
+  if(quick_accept_ && isFarFromObstacles(chain_,workspace_,q1,q2,false))
+    return std::make_pair(1.0,1.0);
 
-  assert(pool_->get_tasks_total() <= running_threads_);
+  /* Same sampling of computeScalingFactorParallel, the joints velocity of (q2,q1) is -dq */
+  workspace_.connection_vector = q2-q1;
+  double slowest_joint_time = (inv_max_speed_.cwiseProduct(workspace_.connection_vector)).cwiseAbs().maxCoeff();
+  workspace_.dq = workspace_.connection_vector/slowest_joint_time;
+  workspace_.delta_q = workspace_.connection_vector/iter;
 
-  double queue_sum;
-  double sum_scaling_factors = 0.0;
-  tic = ros::WallTime::now();
+  initThreadsResources();
 
-  pool_->wait_for_tasks();
-  for(unsigned int i=0;i<running_threads_;i++)
-  {
-    queue_sum = futures_[i].get();
-    sum_scaling_factors += queue_sum;
+  /* Each thread takes chunks of consecutive samples and sums their scaling factors in its own slots */
+  unsigned int n_samples = iter+1;
+  unsigned int chunk_size = scheduler_->getChunkSize();
+  std::vector<double> forward_sums(n_threads_,0.0), backward_sums(n_threads_,0.0);
 
-    if(verbose_>0)
-      ROS_INFO_STREAM("thread "<<i<<" finished");
-  }
-  stop_ = true;
+  scheduler_->forEach((n_samples+chunk_size-1)/chunk_size,[this,&q1,&n_samples,&chunk_size,&forward_sums,&backward_sums](const unsigned int& thread,
+                      const size_t& chunk) ->void{
+    Workspace& workspace = workspaces_[thread];
+    workspace.dq = workspace_.dq;
+    workspace.delta_q = workspace_.delta_q;
 
-  toc = ros::WallTime::now();
-  time_join = (toc-tic).toSec();
-  time_tot = (toc-tic_init).toSec();
+    unsigned int first = chunk*chunk_size;
+    sumScalingFactorsBothWays(chains_[thread],workspace,q1,first,std::min(first+chunk_size,n_samples),forward_sums[thread],backward_sums[thread]);
+  });
 
-  assert([&]() ->bool{
-           if(pool_->get_tasks_running() != 0)
-           {
-             ROS_INFO_STREAM("running threads "<<pool_->get_tasks_running());
-             return false;
-           }
-           return true;
-         }());
+  double forward_sum = 0.0;
+  double backward_sum = 0.0;
+  for(unsigned int thread=0;thread<n_threads_;thread++)
+  {
+    forward_sum  += forward_sums [thread];
+    backward_sum += backward_sums[thread];
+  }
 
-  double scaling_factor = (sum_scaling_factors/((double) n_addends));
+  return std::make_pair(forward_sum/((double) n_samples),backward_sum/((double) n_samples));
+}
 
-  assert([&]() ->bool{
-           if(scaling_factor>=1.0)
-           {
-             return true;
-           }
-           else
-           {
-             ROS_INFO_STREAM("Scaling factor "<<scaling_factor);
-             ROS_INFO_STREAM("sum "<<sum_scaling_factors<<" addends "<<(double) n_addends<<" iter "<< std::max(std::ceil(connection_vector.norm()/max_step_size_),1.0));
-             return false;
-           }
-         }());
+std::vector<double> ParallelSSM15066Estimator2D::computeScalingFactors(const pathplan::ConfigurationsPairs& connections)
+{
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return std::vector<double>(connections.size(),1.0);
 
-  if(verbose_>0)
-  {
-    if(verbose_>1)
-      ROS_INFO_STREAM("time reset queues "<<(time_reset/time_tot)*100<<"% || time fill queues "<<(time_fill/time_tot)*100<<"% || time threads creation "<<(time_thread/time_tot)*100<<"% || time executions "<<(time_join/time_tot)*100<<"%");
+  if(connections.size()<n_threads_)
+    return SSM15066Estimator::computeScalingFactors(connections);
 
-    ROS_ERROR("--------");
-  }
+  initThreadsResources();
 
-  return scaling_factor;
+  /* Each thread takes the next connection to evaluate until all of them have been processed,
+   * so that long and short connections are balanced among the threads */
+  std::vector<double> scaling_factors(connections.size());
+  scheduler_->forEach(connections.size(),[this,&connections,&scaling_factors](const unsigned int& thread, const size_t& idx) ->void{
+    if(kinematics_store_)
+      scaling_factors[idx] = computeScalingFactorFromKinematics(workspaces_[thread],
+                                                                *getEdgeKinematics(chains_[thread],workspaces_[thread],connections[idx].first,connections[idx].second));
+    else
+      scaling_factors[idx] = SSM15066Estimator2D::computeScalingFactor(chains_[thread],workspaces_[thread],connections[idx].first,connections[idx].second);
+  });
+
+  return scaling_factors;
 }
 
-double ParallelSSM15066Estimator2D::computeScalingFactorAsync(const unsigned int& idx_queue)
+std::vector<double> ParallelSSM15066Estimator2D::computePathScalingFactors(const pathplan::Waypoints& waypoints)
 {
-  Eigen::Vector3d distance_vector;
-  std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d>> poi_poses_in_base;
-  std::vector<Eigen::Vector6d, Eigen::aligned_allocator<Eigen::Vector6d>> poi_twist_in_base;
-  double distance, tangential_speed, v_safety, scaling_factor, max_scaling_factor_of_q, sum_scaling_factor;
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return std::vector<double>(std::max(waypoints.size(),(size_t) 1)-1,1.0);
 
-  rosdyn::ChainPtr chain = chains_[idx_queue];
+  if(kinematics_store_ || adaptive_sampling_ || quick_accept_ || quadrature_ || kinematics_interpolation_)
+    return SSM15066Estimator::computePathScalingFactors(waypoints);
 
-  sum_scaling_factor = 0.0;
-  for(const Eigen::VectorXd& q: queues_[idx_queue]->queue_)
-  {
-    max_scaling_factor_of_q = 1.0;
+  std::vector<unsigned int> n_samples;
+  std::vector<Eigen::VectorXd> dqs, delta_qs;
+  computePathSampling(waypoints,dqs,delta_qs,n_samples);
 
-    poi_twist_in_base = chain->getTwist(q,dq_max_);
-    poi_poses_in_base = chain->getTransformations(q);
+  initThreadsResources();
+  return scheduler_->computeAverages(n_samples,[this,&waypoints,&dqs,&delta_qs](const unsigned int& thread, const size_t& connection,
+                                     const unsigned int& i) ->double{
+    Workspace& workspace = workspaces_[thread];
+    workspace.q = waypoints[connection]+i*delta_qs[connection];
 
-    if(verbose_>0)
-      ROS_INFO_STREAM("q -> "<<q.transpose()<<" from queue "<<idx_queue);
+    computePoiKinematics(chains_[thread],workspace.q,dqs[connection],workspace.poi_positions,workspace.poi_velocities);
+    return computeMaxScalingFactorAtPois(workspace.poi_positions,workspace.poi_velocities,workspace.obstacles_idxs);
+  });
+}
 
-    for(Eigen::Index i_obs=0;i_obs<obstacles_positions_.cols();i_obs++)
-    {
-      for(size_t i_poi=0;i_poi<poi_poses_in_base.size();i_poi++)
-      {
-        //consider only links inside the poi_names_ list
-        if(std::find(poi_names_.begin(),poi_names_.end(),frames_names_[i_poi])>=poi_names_.end())
-          continue;
-
-        distance_vector = obstacles_positions_.col(i_obs)-poi_poses_in_base.at(i_poi).translation();
-        distance = distance_vector.norm();
-
-        tangential_speed = ((poi_twist_in_base.at(i_poi).topLeftCorner(3,1)).dot(distance_vector))/distance;
-
-        if(tangential_speed<=0)  // robot is going away
-        {
-          scaling_factor = 1.0;
-        }
-        else if(distance>min_distance_)
-        {
-          v_safety = safeVelocity(distance);
-
-          if(v_safety == 0.0)
-          {
-            if(verbose_>0)
-              ROS_INFO("stop -> v_safety = 0");
-
-            stop_ = true;
-            return std::numeric_limits<double>::infinity();
-          }
-          else
-            scaling_factor = tangential_speed/v_safety; // no division by 0
-
-          assert(v_safety>=0.0);
-        }
-        else  // distance<=min_distance -> you have found the maximum scaling factor, return
-        {
-          if(verbose_>0)
-            ROS_INFO("stop -> distance < min_distance");
-
-          stop_ = true;
-          return std::numeric_limits<double>::infinity();
-        }
-
-        if(scaling_factor>max_scaling_factor_of_q)
-          max_scaling_factor_of_q = scaling_factor;
-
-        if(stop_)
-          break;
-      } // end robot poi for-loop
-      if(stop_)
-        break;
-    } // end obstacles for-loop
+EdgeKinematicsPtr ParallelSSM15066Estimator2D::computeEdgeKinematics(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  EdgeKinematicsPtr kinematics = createEdgeKinematics(q1,q2);
 
-    if(verbose_>0)
-      ROS_INFO_STREAM("q "<<q.transpose()<<" -> scaling factor: "<<max_scaling_factor_of_q);
+  unsigned int n_samples = kinematics->n_samples_;
+  if(not scheduler_->isParallel(n_samples))
+  {
+    computeEdgeKinematicsSamples(chain_,workspace_,*kinematics,0,n_samples);
+    return kinematics;
+  }
 
-    sum_scaling_factor += max_scaling_factor_of_q;
+  initThreadsResources();
 
-    if(stop_)
-      break;
-  } //end q in queue for-loop
+  /* Each thread computes chunks of consecutive samples, in disjoint columns of kinematics */
+  unsigned int chunk_size = scheduler_->getChunkSize();
+  scheduler_->forEach((n_samples+chunk_size-1)/chunk_size,[this,&kinematics,&n_samples,&chunk_size](const unsigned int& thread, const size_t& chunk) ->void{
+    unsigned int first = chunk*chunk_size;
+    computeEdgeKinematicsSamples(chains_[thread],workspaces_[thread],*kinematics,first,std::min(first+chunk_size,n_samples));
+  });
 
-  return sum_scaling_factor;
+  return kinematics;
 }
 
-pathplan::CostPenaltyPtr ParallelSSM15066Estimator2D::clone()
+void ParallelSSM15066Estimator2D::copySettingsTo(SSM15066Estimator& other)
 {
-  ParallelSSM15066Estimator2DPtr cloned_ssm = std::make_shared<ParallelSSM15066Estimator2D>(chain_->clone(),max_step_size_,n_threads_);
+  SSM15066Estimator2D::copySettingsTo(other);
 
-  cloned_ssm->setPoiNames(poi_names_);
-  cloned_ssm->setMaxStepSize(max_step_size_);
-  cloned_ssm->setObstaclesPositions(obstacles_positions_);
+  ParallelSSM15066Estimator2D& other_parallel = static_cast<ParallelSSM15066Estimator2D&>(other);
+  if(scheduler_->getThreadPool())
+    other_parallel.setThreadPool(scheduler_->getThreadPool());
 
-  cloned_ssm->setMaxCartAcc(max_cart_acc_,false);
-  cloned_ssm->setMinDistance(min_distance_,false);
-  cloned_ssm->setReactionTime(reaction_time_,false);
-  cloned_ssm->setHumanVelocity(human_velocity_,false);
+  other_parallel.setChunkSize(scheduler_->getChunkSize());
+  other_parallel.setMinSamplesToParallelize(scheduler_->getMinSamplesToParallelize());
+  other_parallel.setMaxPenaltiesInFlight(scheduler_->getMaxTasksInFlight());
+}
 
-  cloned_ssm->updateMembers();
+pathplan::CostPenaltyPtr ParallelSSM15066Estimator2D::clone()
+{
+  ParallelSSM15066Estimator2DPtr cloned_ssm = std::make_shared<ParallelSSM15066Estimator2D>(chain_->clone(),max_step_size_,n_threads_);
+  copySettingsTo(*cloned_ssm);
 
   pathplan::CostPenaltyPtr clone = cloned_ssm;
 
@@ -0,0 +1,212 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <ssm15066_estimators/poi_kinematics.h>
+#include <algorithm>
+
+namespace ssm15066_estimator
+{
+
+void PoiKinematics::setPoiNames(const std::vector<std::string>& links_names, const std::vector<std::string>& poi_names)
+{
+  poi_idxs_.clear();
+  for(size_t i=0;i<links_names.size();i++)
+  {
+    if(std::find(poi_names.begin(),poi_names.end(),links_names[i])<poi_names.end())
+      poi_idxs_.push_back(i);
+  }
+}
+
+void PoiKinematics::setChain(const rosdyn::ChainPtr& chain)
+{
+  const double probe = 0.1;
+
+  unsigned int n_joints = chain->getActiveJointsNumber();
+  Eigen::VectorXd q = Eigen::VectorXd::Zero(n_joints);
+  std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d>> poses = chain->getTransformations(q);
+
+  base_rotation_ = poses[0].linear();
+  base_translation_ = poses[0].translation();
+
+  links_.resize(poses.size()-1);
+  for(size_t i=1;i<poses.size();i++)
+  {
+    Eigen::Affine3d offset = poses[i-1].inverse()*poses[i];
+    links_[i-1].offset_rotation = offset.linear();
+    links_[i-1].offset_translation = offset.translation();
+    links_[i-1].axis.setZero();
+    links_[i-1].joint = -1;
+    links_[i-1].revolute = false;
+  }
+
+  std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d>> perturbed_poses;
+  for(unsigned int j=0;j<n_joints;j++)
+  {
+    q.setZero();
+    q(j) = probe;
+    perturbed_poses = chain->getTransformations(q);
+
+    /* The first frame whose pose changes is the child frame of joint j, its motion is a rotation around (or a translation along) the joint axis */
+    size_t child = poses.size();
+    for(size_t i=1;i<poses.size();i++)
+    {
+      if(not perturbed_poses[i].isApprox(poses[i],1e-09))
+      {
+        child = i;
+        break;
+      }
+    }
+
+    if(child == poses.size())
+      continue;
+
+    Eigen::Affine3d motion = poses[child].inverse()*perturbed_poses[child];
+    Eigen::AngleAxisd rotation(motion.linear());
+
+    Link& link = links_[child-1];
+    link.joint = j;
+    link.revolute = (std::abs(rotation.angle())>1e-09);
+    link.axis = link.revolute? rotation.axis(): Eigen::Vector3d(motion.translation()/probe);
+  }
+}
+
+void PoiKinematics::computeForwardRecursion(const Eigen::VectorXd& q, const Eigen::VectorXd* dq,
+                                            Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_positions,
+                                            Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>>* poi_velocities,
+                                            Eigen::Ref<Eigen::VectorXd>* poi_twist_norms) const
+{
+  if(poi_idxs_.empty())
+    return;
+
+  /* Pose, linear and angular velocity of the current link in base frame */
+  Eigen::Matrix3d rotation = base_rotation_;
+  Eigen::Vector3d position = base_translation_;
+  Eigen::Vector3d linear_velocity  = Eigen::Vector3d::Zero();
+  Eigen::Vector3d angular_velocity = Eigen::Vector3d::Zero();
+
+  size_t i_poi = 0;
+  for(size_t i=0;;i++)
+  {
+    if(i>0)
+    {
+      const Link& link = links_[i-1];
+
+      Eigen::Vector3d displacement = rotation*link.offset_translation;
+      rotation = rotation*link.offset_rotation;
+
+      Eigen::Vector3d axis_in_base;
+      if(link.joint>=0)
+      {
+        axis_in_base = rotation*link.axis;
+        if(link.revolute)
+          rotation = rotation*Eigen::AngleAxisd(q(link.joint),link.axis).toRotationMatrix();
+        else
+          displacement += axis_in_base*q(link.joint);
+      }
+
+      position += displacement;
+
+      if(dq)
+      {
+        linear_velocity += angular_velocity.cross(displacement);
+        if(link.joint>=0)
+        {
+          if(link.revolute)
+            angular_velocity += axis_in_base*(*dq)(link.joint);
+          else
+            linear_velocity  += axis_in_base*(*dq)(link.joint);
+        }
+      }
+    }
+
+    if(poi_idxs_[i_poi] != i)
+      continue;
+
+    poi_positions.col(i_poi) = position;
+    if(poi_velocities)
+      poi_velocities->col(i_poi) = linear_velocity;
+    if(poi_twist_norms)
+      (*poi_twist_norms)(i_poi) = std::sqrt(linear_velocity.squaredNorm()+angular_velocity.squaredNorm());
+
+    if(++i_poi == poi_idxs_.size())
+      break;
+  }
+}
+
+void PoiKinematics::computePositions(const rosdyn::ChainPtr& chain, const Eigen::VectorXd& q,
+                                     Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_positions) const
+{
+  assert(poi_positions.cols() == (Eigen::Index) poi_idxs_.size());
+
+  if(not links_.empty())
+    return computeForwardRecursion(q,nullptr,poi_positions,nullptr,nullptr);
+
+  const std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d>>& poses_in_base = chain->getTransformations(q);
+  for(size_t i_poi=0;i_poi<poi_idxs_.size();i_poi++)
+    poi_positions.col(i_poi) = poses_in_base[poi_idxs_[i_poi]].translation();
+}
+
+void PoiKinematics::computePositionsAndVelocities(const rosdyn::ChainPtr& chain, const Eigen::VectorXd& q, const Eigen::VectorXd& dq,
+                                                  Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_positions,
+                                                  Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_velocities) const
+{
+  assert(poi_velocities.cols() == (Eigen::Index) poi_idxs_.size());
+
+  if(not links_.empty())
+    return computeForwardRecursion(q,&dq,poi_positions,&poi_velocities,nullptr);
+
+  /* The twists computation updates the chain transformations at q, so they are read after it */
+  const std::vector<Eigen::Vector6d, Eigen::aligned_allocator<Eigen::Vector6d>>& twists_in_base = chain->getTwist(q,dq);
+  for(size_t i_poi=0;i_poi<poi_idxs_.size();i_poi++)
+    poi_velocities.col(i_poi) = twists_in_base[poi_idxs_[i_poi]].topRows(3);
+
+  computePositions(chain,q,poi_positions);
+}
+
+void PoiKinematics::computePositionsAndVelocities(const rosdyn::ChainPtr& chain, const Eigen::VectorXd& q, const Eigen::VectorXd& dq,
+                                                  Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_positions,
+                                                  Eigen::Ref<Eigen::Matrix<double,3,Eigen::Dynamic>> poi_velocities,
+                                                  Eigen::Ref<Eigen::VectorXd> poi_twist_norms) const
+{
+  assert(poi_velocities.cols() == (Eigen::Index) poi_idxs_.size());
+  assert(poi_twist_norms.rows() == (Eigen::Index) poi_idxs_.size());
+
+  if(not links_.empty())
+    return computeForwardRecursion(q,&dq,poi_positions,&poi_velocities,&poi_twist_norms);
+
+  const std::vector<Eigen::Vector6d, Eigen::aligned_allocator<Eigen::Vector6d>>& twists_in_base = chain->getTwist(q,dq);
+  for(size_t i_poi=0;i_poi<poi_idxs_.size();i_poi++)
+  {
+    poi_velocities.col(i_poi) = twists_in_base[poi_idxs_[i_poi]].topRows(3);
+    poi_twist_norms(i_poi) = twists_in_base[poi_idxs_[i_poi]].norm();
+  }
+
+  computePositions(chain,q,poi_positions);
+}
+
+}
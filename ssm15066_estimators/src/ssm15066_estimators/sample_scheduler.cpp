@@ -0,0 +1,336 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <algorithm>
+#include <ssm15066_estimators/sample_scheduler.h>
+
+namespace ssm15066_estimator
+{
+
+SampleScheduler::SampleScheduler(const unsigned int& n_threads, const ThreadPoolPtr& pool):
+  n_threads_(n_threads),pool_(pool)
+{
+  shared_pool_ = (pool_ != nullptr);
+
+  chunk_size_ = 4;
+  min_samples_to_parallelize_ = 16;
+
+  if(n_threads_<=0)
+    n_threads_ = std::thread::hardware_concurrency();
+  else if(n_threads_>std::thread::hardware_concurrency())
+  {
+    ROS_ERROR_STREAM("number of threads ("<<n_threads_<<") should not be higher than hardware max concurrency ("<<std::thread::hardware_concurrency()<<")");
+    n_threads_ = std::thread::hardware_concurrency();
+  }
+
+  max_tasks_in_flight_ = 2*n_threads_;
+  for(unsigned int slot=max_tasks_in_flight_;slot>0;slot--)
+    free_slots_.push_back(slot-1);
+}
+
+ThreadPoolPtr SampleScheduler::getSharedPool()
+{
+  static ThreadPoolPtr shared_pool = std::make_shared<BS::thread_pool>(std::thread::hardware_concurrency());
+  return shared_pool;
+}
+
+BS::thread_pool& SampleScheduler::getPool()
+{
+  /* The pool is created by the thread calling the scheduler, no other thread uses it before */
+  if(not pool_)
+    pool_ = std::make_shared<BS::thread_pool>(n_threads_);
+
+  return *pool_;
+}
+
+SampleScheduler::~SampleScheduler()
+{
+  /* The submitted tasks refer to the scheduler */
+  waitForTasks();
+}
+
+void SampleScheduler::setMaxTasksInFlight(const unsigned int& max_tasks)
+{
+  std::unique_lock<std::mutex> lock(tasks_mtx_);
+  tasks_cv_.wait(lock,[this]() ->bool{return free_slots_.size() == max_tasks_in_flight_;});
+
+  max_tasks_in_flight_ = std::max(max_tasks,1u);
+
+  free_slots_.clear();
+  for(unsigned int slot=max_tasks_in_flight_;slot>0;slot--)
+    free_slots_.push_back(slot-1);
+}
+
+unsigned int SampleScheduler::getTasksInFlight()
+{
+  std::lock_guard<std::mutex> lock(tasks_mtx_);
+  return max_tasks_in_flight_-free_slots_.size();
+}
+
+void SampleScheduler::releaseSlot(const unsigned int& slot)
+{
+  /* Notify while holding the lock, waitForTasks may destroy the scheduler as soon as it can lock */
+  std::lock_guard<std::mutex> lock(tasks_mtx_);
+  free_slots_.push_back(slot);
+  tasks_cv_.notify_all();
+}
+
+std::future<double> SampleScheduler::submit(const TaskFunction& task)
+{
+  unsigned int slot;
+  {
+    std::unique_lock<std::mutex> lock(tasks_mtx_);
+    tasks_cv_.wait(lock,[this]() ->bool{return not free_slots_.empty();});
+
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+
+  return getPool().submit([this,task,slot]() ->double{
+    double value;
+    try
+    {
+      value = task(slot);
+    }
+    catch(...)
+    {
+      releaseSlot(slot);
+      throw;
+    }
+
+    releaseSlot(slot);
+    return value;
+  });
+}
+
+void SampleScheduler::waitForTasks()
+{
+  std::unique_lock<std::mutex> lock(tasks_mtx_);
+  tasks_cv_.wait(lock,[this]() ->bool{return free_slots_.size() == max_tasks_in_flight_;});
+}
+
+double SampleScheduler::computeSumOfChunks(const unsigned int& thread, SampleBatch& batch)
+{
+  double scaling_factor, chunk_sum;
+  double sum_scaling_factor = 0.0;
+
+  unsigned int first, last;
+
+  for(unsigned int chunk=batch.next_chunk++;chunk<batch.n_chunks;chunk=batch.next_chunk++)
+  {
+    first = chunk*batch.chunk_size;
+    last = std::min(first+batch.chunk_size,batch.n_samples);
+
+    chunk_sum = 0.0;
+    for(unsigned int i=first;i<last;i++)
+    {
+      if(batch.stop.load(std::memory_order_relaxed))
+        return sum_scaling_factor;
+
+      scaling_factor = (*batch.sample_function)(thread,i);
+      if(scaling_factor == std::numeric_limits<double>::infinity())
+      {
+        batch.stop = true;
+        return std::numeric_limits<double>::infinity();
+      }
+
+      chunk_sum += scaling_factor;
+    }
+
+    sum_scaling_factor += chunk_sum;
+
+    /* Each sample not evaluated yet adds at least 1.0, stop if the average is already proven to be higher than the bound */
+    if(batch.max_average<std::numeric_limits<double>::infinity())
+    {
+      std::lock_guard<std::mutex> lock(batch.mtx);
+      batch.excess += chunk_sum-(last-first);
+      if((batch.n_samples+batch.excess)/((double) batch.n_samples)>batch.max_average)
+      {
+        batch.bound_exceeded = true;
+        batch.stop = true;
+      }
+    }
+  }
+
+  return sum_scaling_factor;
+}
+
+void SampleScheduler::runTask(const unsigned int& thread, const SampleBatchPtr& batch)
+{
+  {
+    /* The caller does not wait for the tasks starting after the batch has been stopped or exhausted */
+    std::lock_guard<std::mutex> lock(batch->mtx);
+    if(batch->stop || batch->next_chunk>=batch->n_chunks)
+      return;
+
+    batch->running++;
+  }
+
+  double sum_scaling_factor = computeSumOfChunks(thread,*batch);
+
+  std::lock_guard<std::mutex> lock(batch->mtx);
+  if(sum_scaling_factor == std::numeric_limits<double>::infinity())
+    batch->infinite = true;
+  else
+    batch->sum += sum_scaling_factor;
+
+  batch->running--;
+  batch->cv.notify_all();
+}
+
+double SampleScheduler::computeAverage(const unsigned int& n_samples, const SampleFunction& sample_function, const double& max_average)
+{
+  if(n_samples == 0)
+    return 1.0;
+
+  if(not batch_ || batch_.use_count()>1)
+    batch_ = std::make_shared<SampleBatch>();
+
+  SampleBatchPtr batch = batch_;
+  batch->stop = false;
+  batch->next_chunk = 0;
+  batch->n_samples = n_samples;
+  batch->chunk_size = chunk_size_;
+  batch->n_chunks = (n_samples+chunk_size_-1)/chunk_size_;
+  batch->max_average = max_average;
+  batch->sample_function = &sample_function;
+  batch->running = 0;
+  batch->sum = 0.0;
+  batch->excess = 0.0;
+  batch->infinite = false;
+  batch->bound_exceeded = false;
+
+  /* The calling thread is thread 0 */
+  unsigned int n_tasks = isParallel(n_samples)? std::min(n_threads_,batch->n_chunks)-1: 0;
+  for(unsigned int i=0;i<n_tasks;i++)
+    getPool().push_task([i,batch]() ->void{runTask(i+1,batch);});
+
+  double sum_scaling_factor = computeSumOfChunks(0,*batch);
+
+  /* All the chunks have been taken or the batch has been stopped: wait only for the tasks evaluating a sample (each of them
+   * stops at its next sample), since sample_function refers to the caller resources. The tasks still queued are not waited for */
+  std::unique_lock<std::mutex> lock(batch->mtx);
+  batch->cv.wait(lock,[&batch]() ->bool{return batch->running == 0;});
+
+  if(batch->infinite || sum_scaling_factor == std::numeric_limits<double>::infinity())
+    return std::numeric_limits<double>::infinity();
+
+  /* Stopped by the bound: the samples not evaluated are counted as 1.0, the result is a lower bound of the average higher than max_average */
+  if(batch->bound_exceeded)
+    return (n_samples+batch->excess)/((double) n_samples);
+
+  return (sum_scaling_factor+batch->sum)/((double) n_samples);
+}
+
+void SampleScheduler::runItemsTask(const unsigned int& thread, const ItemBatchPtr& batch)
+{
+  {
+    /* The caller does not wait for the tasks starting after all the items have been taken */
+    std::lock_guard<std::mutex> lock(batch->mtx);
+    if(batch->next_item>=batch->n_items)
+      return;
+
+    batch->running++;
+  }
+
+  for(size_t item=batch->next_item++;item<batch->n_items;item=batch->next_item++)
+    (*batch->item_function)(thread,item);
+
+  std::lock_guard<std::mutex> lock(batch->mtx);
+  batch->running--;
+  batch->cv.notify_all();
+}
+
+void SampleScheduler::forEach(const size_t& n_items, const ItemFunction& item_function)
+{
+  ItemBatchPtr batch = std::make_shared<ItemBatch>();
+  batch->next_item = 0;
+  batch->n_items = n_items;
+  batch->item_function = &item_function;
+  batch->running = 0;
+
+  /* The calling thread is thread 0 */
+  unsigned int n_tasks = std::min((size_t) n_threads_,n_items);
+  n_tasks = (n_tasks>0)? n_tasks-1: 0;
+
+  for(unsigned int i=0;i<n_tasks;i++)
+    getPool().push_task([i,batch]() ->void{runItemsTask(i+1,batch);});
+
+  for(size_t item=batch->next_item++;item<n_items;item=batch->next_item++)
+    item_function(0,item);
+
+  /* All the items have been taken: wait only for the tasks processing one of them, since item_function refers to the caller resources */
+  std::unique_lock<std::mutex> lock(batch->mtx);
+  batch->cv.wait(lock,[&batch]() ->bool{return batch->running == 0;});
+}
+
+std::vector<double> SampleScheduler::computeAverages(const std::vector<unsigned int>& n_samples, const GroupSampleFunction& sample_function)
+{
+  /* first_samples[g] is the index of the first sample of group g in the sequence of all the samples */
+  std::vector<size_t> first_samples(n_samples.size()+1,0);
+  for(size_t group=0;group<n_samples.size();group++)
+    first_samples[group+1] = first_samples[group]+n_samples[group];
+
+  size_t n_chunks = (first_samples.back()+chunk_size_-1)/chunk_size_;
+
+  /* Each thread sums into its own row, so no synchronization is needed */
+  std::vector<std::vector<double>> sums(n_threads_,std::vector<double>(n_samples.size(),0.0));
+
+  forEach(n_chunks,[this,&first_samples,&sums,&sample_function](const unsigned int& thread, const size_t& chunk) ->void{
+    size_t first_sample = chunk*chunk_size_;
+    size_t last_sample = std::min(first_sample+chunk_size_,first_samples.back());
+
+    size_t group = std::upper_bound(first_samples.begin(),first_samples.end(),first_sample)-first_samples.begin()-1;
+    for(size_t sample=first_sample;sample<last_sample;sample++)
+    {
+      while(sample>=first_samples[group+1])
+        group++;
+
+      /* After an infinite scaling factor, the other samples of the group are not evaluated */
+      if(sums[thread][group]<std::numeric_limits<double>::infinity())
+        sums[thread][group] += sample_function(thread,group,sample-first_samples[group]);
+    }
+  });
+
+  std::vector<double> averages(n_samples.size(),1.0);
+  for(size_t group=0;group<n_samples.size();group++)
+  {
+    if(n_samples[group] == 0)
+      continue;
+
+    double sum = 0.0;
+    for(unsigned int thread=0;thread<n_threads_;thread++)
+      sum += sums[thread][group];
+
+    averages[group] = sum/((double) n_samples[group]);
+  }
+
+  return averages;
+}
+
+}
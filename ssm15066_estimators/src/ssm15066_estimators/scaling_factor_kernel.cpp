@@ -0,0 +1,290 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <ssm15066_estimators/scaling_factor_kernel.h>
+#include <ros/ros.h>
+#include <limits>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SSM15066_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace ssm15066_estimator
+{
+
+namespace
+{
+/* Coordinate of the padding obstacles, far enough to be out of any influence distance */
+const double padding_coordinate = 1.0e10;
+
+/* Padding of the obstacles arrays, equal to the AVX-512 vector width */
+const size_t padding = 8;
+
+/**
+ * @brief Data shared by the kernels for a single poi.
+ */
+struct PoiData
+{
+  double px, py, pz;
+  double vx, vy, vz;
+  double squared_influence_distance;
+  double min_distance, two_max_cart_acc, term1, term2;
+};
+
+/* Returns the maximum scaling factor of the poi, infinity if the robot must stop */
+double maxScalingFactorScalar(const double* ox, const double* oy, const double* oz, const size_t& n, const PoiData& poi)
+{
+  double rx, ry, rz, dot, squared_distance, distance, v_safety;
+  double max_scaling_factor = 1.0;
+
+  for(size_t i=0;i<n;i++)
+  {
+    rx = ox[i]-poi.px;
+    ry = oy[i]-poi.py;
+    rz = oz[i]-poi.pz;
+
+    dot = poi.vx*rx+poi.vy*ry+poi.vz*rz;
+    squared_distance = rx*rx+ry*ry+rz*rz;
+
+    if(dot<=0.0 || squared_distance>poi.squared_influence_distance)  // going away or too far to slow the robot down
+      continue;
+
+    distance = std::sqrt(squared_distance);
+    v_safety = std::sqrt(std::max(poi.term1+poi.two_max_cart_acc*distance,0.0))+poi.term2;
+
+    if(distance<=poi.min_distance || v_safety<=0.0)
+      return std::numeric_limits<double>::infinity();
+
+    max_scaling_factor = std::max(max_scaling_factor,dot/(distance*v_safety));
+  }
+
+  return max_scaling_factor;
+}
+
+#ifdef SSM15066_X86_KERNELS
+__attribute__((target("avx2,fma")))
+double maxScalingFactorAvx2(const double* ox, const double* oy, const double* oz, const size_t& n, const PoiData& poi)
+{
+  const __m256d px = _mm256_set1_pd(poi.px), py = _mm256_set1_pd(poi.py), pz = _mm256_set1_pd(poi.pz);
+  const __m256d vx = _mm256_set1_pd(poi.vx), vy = _mm256_set1_pd(poi.vy), vz = _mm256_set1_pd(poi.vz);
+  const __m256d squared_influence_distance = _mm256_set1_pd(poi.squared_influence_distance);
+  const __m256d min_distance = _mm256_set1_pd(poi.min_distance);
+  const __m256d two_max_cart_acc = _mm256_set1_pd(poi.two_max_cart_acc);
+  const __m256d term1 = _mm256_set1_pd(poi.term1), term2 = _mm256_set1_pd(poi.term2);
+  const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+
+  __m256d rx, ry, rz, dot, squared_distance, distance, v_safety, mask, stop, scaling_factor;
+  __m256d max_scaling_factor = one;
+
+  for(size_t i=0;i<n;i+=4)
+  {
+    rx = _mm256_sub_pd(_mm256_loadu_pd(ox+i),px);
+    ry = _mm256_sub_pd(_mm256_loadu_pd(oy+i),py);
+    rz = _mm256_sub_pd(_mm256_loadu_pd(oz+i),pz);
+
+    dot = _mm256_fmadd_pd(vz,rz,_mm256_fmadd_pd(vy,ry,_mm256_mul_pd(vx,rx)));
+    squared_distance = _mm256_fmadd_pd(rz,rz,_mm256_fmadd_pd(ry,ry,_mm256_mul_pd(rx,rx)));
+
+    mask = _mm256_and_pd(_mm256_cmp_pd(dot,zero,_CMP_GT_OQ),_mm256_cmp_pd(squared_distance,squared_influence_distance,_CMP_LE_OQ));
+    if(_mm256_movemask_pd(mask) == 0)
+      continue;
+
+    distance = _mm256_sqrt_pd(squared_distance);
+    v_safety = _mm256_add_pd(_mm256_sqrt_pd(_mm256_max_pd(_mm256_fmadd_pd(two_max_cart_acc,distance,term1),zero)),term2);
+
+    stop = _mm256_and_pd(mask,_mm256_or_pd(_mm256_cmp_pd(distance,min_distance,_CMP_LE_OQ),_mm256_cmp_pd(v_safety,zero,_CMP_LE_OQ)));
+    if(_mm256_movemask_pd(stop) != 0)
+      return std::numeric_limits<double>::infinity();
+
+    scaling_factor = _mm256_blendv_pd(one,_mm256_div_pd(dot,_mm256_mul_pd(distance,v_safety)),mask);
+    max_scaling_factor = _mm256_max_pd(max_scaling_factor,scaling_factor);
+  }
+
+  __m128d max_2 = _mm_max_pd(_mm256_castpd256_pd128(max_scaling_factor),_mm256_extractf128_pd(max_scaling_factor,1));
+  return std::max(_mm_cvtsd_f64(max_2),_mm_cvtsd_f64(_mm_unpackhi_pd(max_2,max_2)));
+}
+
+__attribute__((target("avx512f")))
+double maxScalingFactorAvx512(const double* ox, const double* oy, const double* oz, const size_t& n, const PoiData& poi)
+{
+  const __m512d px = _mm512_set1_pd(poi.px), py = _mm512_set1_pd(poi.py), pz = _mm512_set1_pd(poi.pz);
+  const __m512d vx = _mm512_set1_pd(poi.vx), vy = _mm512_set1_pd(poi.vy), vz = _mm512_set1_pd(poi.vz);
+  const __m512d squared_influence_distance = _mm512_set1_pd(poi.squared_influence_distance);
+  const __m512d min_distance = _mm512_set1_pd(poi.min_distance);
+  const __m512d two_max_cart_acc = _mm512_set1_pd(poi.two_max_cart_acc);
+  const __m512d term1 = _mm512_set1_pd(poi.term1), term2 = _mm512_set1_pd(poi.term2);
+  const __m512d zero = _mm512_setzero_pd(), one = _mm512_set1_pd(1.0);
+
+  __m512d rx, ry, rz, dot, squared_distance, distance, v_safety, scaling_factor;
+  __mmask8 mask, stop;
+  __m512d max_scaling_factor = one;
+
+  for(size_t i=0;i<n;i+=8)
+  {
+    rx = _mm512_sub_pd(_mm512_loadu_pd(ox+i),px);
+    ry = _mm512_sub_pd(_mm512_loadu_pd(oy+i),py);
+    rz = _mm512_sub_pd(_mm512_loadu_pd(oz+i),pz);
+
+    dot = _mm512_fmadd_pd(vz,rz,_mm512_fmadd_pd(vy,ry,_mm512_mul_pd(vx,rx)));
+    squared_distance = _mm512_fmadd_pd(rz,rz,_mm512_fmadd_pd(ry,ry,_mm512_mul_pd(rx,rx)));
+
+    mask = _mm512_cmp_pd_mask(dot,zero,_CMP_GT_OQ) & _mm512_cmp_pd_mask(squared_distance,squared_influence_distance,_CMP_LE_OQ);
+    if(mask == 0)
+      continue;
+
+    distance = _mm512_sqrt_pd(squared_distance);
+    v_safety = _mm512_add_pd(_mm512_sqrt_pd(_mm512_max_pd(_mm512_fmadd_pd(two_max_cart_acc,distance,term1),zero)),term2);
+
+    stop = mask & (_mm512_cmp_pd_mask(distance,min_distance,_CMP_LE_OQ) | _mm512_cmp_pd_mask(v_safety,zero,_CMP_LE_OQ));
+    if(stop != 0)
+      return std::numeric_limits<double>::infinity();
+
+    scaling_factor = _mm512_mask_blend_pd(mask,one,_mm512_div_pd(dot,_mm512_mul_pd(distance,v_safety)));
+    max_scaling_factor = _mm512_max_pd(max_scaling_factor,scaling_factor);
+  }
+
+  return _mm512_reduce_max_pd(max_scaling_factor);
+}
+#endif
+}
+
+ScalingFactorKernel::ScalingFactorKernel()
+{
+  n_obstacles_ = 0;
+  instruction_set_ = getBestInstructionSet();
+}
+
+ScalingFactorKernel::InstructionSet ScalingFactorKernel::getBestInstructionSet()
+{
+#ifdef SSM15066_X86_KERNELS
+  if(__builtin_cpu_supports("avx512f"))
+    return InstructionSet::AVX512;
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return InstructionSet::AVX2;
+#endif
+  return InstructionSet::SCALAR;
+}
+
+std::string ScalingFactorKernel::toString(const InstructionSet& instruction_set)
+{
+  switch(instruction_set)
+  {
+  case InstructionSet::AVX512:
+    return "AVX-512";
+  case InstructionSet::AVX2:
+    return "AVX2";
+  default:
+    return "scalar";
+  }
+}
+
+void ScalingFactorKernel::setInstructionSet(const InstructionSet& instruction_set)
+{
+  InstructionSet best = getBestInstructionSet();
+  if((int) instruction_set>(int) best)
+  {
+    ROS_WARN_STREAM("instruction set "<<toString(instruction_set)<<" not supported, "<<toString(best)<<" used");
+    instruction_set_ = best;
+  }
+  else
+    instruction_set_ = instruction_set;
+}
+
+void ScalingFactorKernel::setObstacles(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions)
+{
+  n_obstacles_ = obstacles_positions.cols();
+  size_t n_padded = ((n_obstacles_+padding-1)/padding)*padding;
+
+  obstacles_x_.assign(n_padded,padding_coordinate);
+  obstacles_y_.assign(n_padded,padding_coordinate);
+  obstacles_z_.assign(n_padded,padding_coordinate);
+
+  for(size_t i=0;i<n_obstacles_;i++)
+  {
+    obstacles_x_[i] = obstacles_positions(0,i);
+    obstacles_y_[i] = obstacles_positions(1,i);
+    obstacles_z_[i] = obstacles_positions(2,i);
+  }
+}
+
+double ScalingFactorKernel::computeMaxScalingFactor(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                                    const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                                                    const double& min_distance, const double& max_cart_acc, const double& term1, const double& term2) const
+{
+  if(n_obstacles_ == 0)
+    return 1.0;
+
+  PoiData poi;
+  poi.min_distance = min_distance;
+  poi.two_max_cart_acc = 2.0*max_cart_acc;
+  poi.term1 = term1;
+  poi.term2 = term2;
+
+  double speed, influence_distance, scaling_factor;
+  double max_scaling_factor = 1.0;
+  size_t n_padded = obstacles_x_.size();
+
+  for(Eigen::Index i_poi=0;i_poi<poi_positions.cols();i_poi++)
+  {
+    speed = poi_velocities.col(i_poi).norm();
+    if(speed == 0.0)  // the tangential speed is zero w.r.t. every obstacle
+      continue;
+
+    /* Same as SSM15066Estimator::computeInfluenceDistance */
+    influence_distance = std::max((std::pow(speed-term2,2.0)-term1)/(2.0*max_cart_acc),min_distance);
+
+    poi.px = poi_positions(0,i_poi); poi.py = poi_positions(1,i_poi); poi.pz = poi_positions(2,i_poi);
+    poi.vx = poi_velocities(0,i_poi); poi.vy = poi_velocities(1,i_poi); poi.vz = poi_velocities(2,i_poi);
+    poi.squared_influence_distance = influence_distance*influence_distance;
+
+    switch(instruction_set_)
+    {
+#ifdef SSM15066_X86_KERNELS
+    case InstructionSet::AVX512:
+      scaling_factor = maxScalingFactorAvx512(obstacles_x_.data(),obstacles_y_.data(),obstacles_z_.data(),n_padded,poi);
+      break;
+    case InstructionSet::AVX2:
+      scaling_factor = maxScalingFactorAvx2(obstacles_x_.data(),obstacles_y_.data(),obstacles_z_.data(),n_padded,poi);
+      break;
+#endif
+    default:
+      scaling_factor = maxScalingFactorScalar(obstacles_x_.data(),obstacles_y_.data(),obstacles_z_.data(),n_obstacles_,poi);
+    }
+
+    if(scaling_factor == std::numeric_limits<double>::infinity())
+      return scaling_factor;
+
+    max_scaling_factor = std::max(max_scaling_factor,scaling_factor);
+  }
+
+  return max_scaling_factor;
+}
+
+}
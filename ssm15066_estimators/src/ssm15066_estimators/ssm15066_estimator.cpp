@@ -25,11 +25,23 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <chrono>
 #include <ssm15066_estimators/ssm15066_estimator.h>
 
 namespace ssm15066_estimator
 {
 
+const double SSM15066Estimator::kronrod_nodes_[8] = {0.991455371120812639206854697526329,0.949107912342758524526189684047851,
+                                                     0.864864423359769072789712788640926,0.741531185599394439863864773280788,
+                                                     0.586087235467691130294144845693013,0.405845151377397166906606412076961,
+                                                     0.207784955007898467600689403773245,0.000000000000000000000000000000000};
+const double SSM15066Estimator::kronrod_weights_[8] = {0.022935322010529224963732008058970,0.063092092629978553290700663189204,
+                                                       0.104790010322250183839876322541518,0.140653259715525918745189590510238,
+                                                       0.169004726639267902826583426598550,0.190350578064785409913256402421014,
+                                                       0.204432940075298892414161999234649,0.209482141084727828012999174891714};
+const double SSM15066Estimator::gauss_weights_[4] = {0.129484966168869693270611432679082,0.279705391489276667901467771423780,
+                                                     0.381830050505118944950369775488975,0.417959183673469387755102040816327};
+
 SSM15066Estimator::SSM15066Estimator(const rosdyn::ChainPtr &chain, const double& max_step_size):
   CostPenalty(), chain_(chain)
 {
@@ -46,6 +58,23 @@ SSM15066Estimator::SSM15066Estimator(const rosdyn::ChainPtr &chain, const double
 
   frames_names_ = chain_->getLinksName();
   poi_names_ = frames_names_;
+  poi_kinematics_.setChain(chain_);
+  updatePoiIdxs();
+
+  adaptive_sampling_ = false;
+  adaptive_sampling_tolerance_ = 0.0;
+
+  quick_accept_ = false;
+  quick_accept_checks_ = 0;
+  quick_accepts_ = 0;
+
+  quadrature_ = false;
+  quadrature_absolute_tolerance_ = 1e-03;
+  quadrature_relative_tolerance_ = 1e-03;
+
+  obstacles_index_threshold_ = 32;
+  obstacles_index_ = std::make_shared<ObstaclesIndex>();
+  updateObstaclesIndexes();
 
   verbose_ = 0;
 }
@@ -66,34 +95,568 @@ SSM15066Estimator::SSM15066Estimator(const rosdyn::ChainPtr &chain, const double
 
   frames_names_ = chain_->getLinksName();
   poi_names_ = frames_names_;
+  poi_kinematics_.setChain(chain_);
+  updatePoiIdxs();
+
+  adaptive_sampling_ = false;
+  adaptive_sampling_tolerance_ = 0.0;
+
+  quick_accept_ = false;
+  quick_accept_checks_ = 0;
+  quick_accepts_ = 0;
+
+  quadrature_ = false;
+  quadrature_absolute_tolerance_ = 1e-03;
+  quadrature_relative_tolerance_ = 1e-03;
+
+  obstacles_index_threshold_ = 32;
+  obstacles_index_ = std::make_shared<ObstaclesIndex>();
+  updateObstaclesIndexes();
 
   verbose_ = 0;
 }
 
 void SSM15066Estimator::updateMembers()
 {
+  waitForSubmittedPenalties();
+
   double a_tr = max_cart_acc_*reaction_time_;
   term1_ = std::pow(human_velocity_,2.0)+std::pow(a_tr,2.0)-2.0*max_cart_acc_*min_distance_;
   term2_ = -a_tr-human_velocity_;
+
+  increaseSceneVersion();
 }
 
 void SSM15066Estimator::setMaxStepSize(const double& max_step_size)
 {
+  waitForSubmittedPenalties();
+
   max_step_size_ = max_step_size;
   if(max_step_size_<=0)
   {
     ROS_ERROR("max_step_size must be positive, set equal to 0.05");
     max_step_size_ = 0.05;
   }
+
+  if(kinematics_store_)
+    kinematics_store_->clear();
+
+  increaseSceneVersion();
 }
 
 void SSM15066Estimator::addObstaclePosition(const Eigen::Vector3d& obstacle_position)
 {
+  waitForSubmittedPenalties();
+
   obstacles_positions_.conservativeResize(Eigen::NoChange, obstacles_positions_.cols()+1);
 
   if(obstacle_position.rows()>1) // column vector
     obstacles_positions_.col(obstacles_positions_.cols()-1) = obstacle_position;
   else
     obstacles_positions_.col(obstacles_positions_.cols()-1) = obstacle_position.transpose();  // make it a column vector
+
+  if(distance_field_)
+    distance_field_->add(obstacles_positions_.col(obstacles_positions_.cols()-1));
+
+  updateObstaclesIndexes(false);
+  increaseSceneVersion();
+}
+
+void SSM15066Estimator::updatePoiIdxs()
+{
+  poi_kinematics_.setPoiNames(frames_names_,poi_names_);
+  poi_idxs_ = poi_kinematics_.getPoiIdxs();
+
+  updatePoiLevers();
+}
+
+void SSM15066Estimator::updatePoiLevers()
+{
+  unsigned int n_joints = chain_->getActiveJointsNumber();
+  poi_levers_.setZero(poi_idxs_.size(),n_joints);
+
+  Eigen::VectorXd q = Eigen::VectorXd::Zero(n_joints);
+  std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d>> poses = chain_->getTransformations(q);
+
+  /* Length of the chain from the base to each frame */
+  std::vector<double> chain_length(poses.size(),0.0);
+  for(size_t i=1;i<poses.size();i++)
+    chain_length[i] = chain_length[i-1]+(poses[i].translation()-poses[i-1].translation()).norm();
+
+  std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d>> perturbed_poses;
+  for(unsigned int j=0;j<n_joints;j++)
+  {
+    q.setZero();
+    q(j) = 0.1;
+    perturbed_poses = chain_->getTransformations(q);
+
+    /* The first frame whose pose changes is the child frame of joint j */
+    size_t child = poses.size();
+    for(size_t i=0;i<poses.size();i++)
+    {
+      if(not perturbed_poses[i].isApprox(poses[i],1e-09))
+      {
+        child = i;
+        break;
+      }
+    }
+
+    if(child == poses.size())
+      continue;
+
+    bool revolute = not perturbed_poses[child].linear().isApprox(poses[child].linear(),1e-09);
+    for(size_t i_poi=0;i_poi<poi_idxs_.size();i_poi++)
+    {
+      if(poi_idxs_[i_poi]<child)
+        continue;
+
+      poi_levers_(i_poi,j) = revolute? (chain_length[poi_idxs_[i_poi]]-chain_length[child]): 1.0;
+    }
+  }
+}
+
+void SSM15066Estimator::computePoiKinematics(const rosdyn::ChainPtr& chain, const Eigen::VectorXd& q, const Eigen::VectorXd& dq,
+                                             Eigen::Matrix<double,3,Eigen::Dynamic>& poi_positions, Eigen::Matrix<double,3,Eigen::Dynamic>& poi_velocities)
+{
+  poi_positions .resize(3,poi_idxs_.size());
+  poi_velocities.resize(3,poi_idxs_.size());
+  poi_kinematics_.computePositionsAndVelocities(chain,q,dq,poi_positions,poi_velocities);
+}
+
+double SSM15066Estimator::computeDistanceFromObstacles(const Eigen::Ref<const Eigen::Vector3d>& position)
+{
+  double distance = std::numeric_limits<double>::max();
+
+  if(useObstaclesIndex())
+  {
+    obstacles_index_->nearest(position,distance);
+  }
+  else
+  {
+    for(Eigen::Index i_obs=0;i_obs<obstacles_positions_.cols();i_obs++)
+      distance = std::min(distance,(obstacles_positions_.col(i_obs)-position).norm());
+  }
+
+  return distance;
+}
+
+bool SSM15066Estimator::isFarFromObstacles(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                                           const bool& twist_speeds)
+{
+  quick_accept_checks_++;
+
+  Eigen::VectorXd& dq = workspace.dq;
+  Eigen::VectorXd& connection_vector = workspace.connection_vector;
+  Eigen::Matrix<double,3,Eigen::Dynamic>& first_poi_positions = workspace.poi_positions;
+  Eigen::Matrix<double,3,Eigen::Dynamic>& last_poi_positions = workspace.next_poi_positions;
+
+  /* Same joints velocity of the sampling, see computeScalingFactor */
+  connection_vector = q2-q1;
+  double slowest_joint_time = (inv_max_speed_.cwiseProduct(connection_vector)).cwiseAbs().maxCoeff();
+  if(slowest_joint_time<=0.0)
+    return false;
+
+  dq = connection_vector/slowest_joint_time;
+
+  /* The 1D estimators compare the speed of every poi with the minimum distance of all the pois, so all of them share the highest bound */
+  double influence_distance = 0.0;
+  if(twist_speeds)
+  {
+    double max_speed = 0.0;
+    for(Eigen::Index i_poi=0;i_poi<poi_levers_.rows();i_poi++)
+      max_speed = std::max(max_speed,poi_levers_.row(i_poi).dot(dq.cwiseAbs()));
+
+    influence_distance = computeInfluenceDistance(max_speed+dq.cwiseAbs().sum());
+  }
+
+  /* A poi closer than its influence distance at q1 may be slowed down, do not compute the kinematics of q2 */
+  first_poi_positions.resize(3,poi_idxs_.size());
+  poi_kinematics_.computePositions(chain,q1,first_poi_positions);
+
+  for(Eigen::Index i_poi=0;i_poi<first_poi_positions.cols();i_poi++)
+  {
+    if(not twist_speeds)
+      influence_distance = computeInfluenceDistance(poi_levers_.row(i_poi).dot(dq.cwiseAbs()));
+
+    if(computeDistanceFromObstacles(first_poi_positions.col(i_poi))<=influence_distance)
+      return false;
+  }
+
+  /* Travelling a path not longer than poi_max_travel, at s the poi is farther than d(q1)-s and d(q2)-(poi_max_travel-s) from the obstacles */
+  last_poi_positions.resize(3,poi_idxs_.size());
+  poi_kinematics_.computePositions(chain,q2,last_poi_positions);
+
+  double poi_max_travel, poi_min_distance;
+  for(Eigen::Index i_poi=0;i_poi<last_poi_positions.cols();i_poi++)
+  {
+    if(not twist_speeds)
+      influence_distance = computeInfluenceDistance(poi_levers_.row(i_poi).dot(dq.cwiseAbs()));
+
+    poi_max_travel = poi_levers_.row(i_poi).dot(connection_vector.cwiseAbs());
+    poi_min_distance = 0.5*computeDistanceFromObstacles(first_poi_positions.col(i_poi))+
+        0.5*computeDistanceFromObstacles(last_poi_positions.col(i_poi))-0.5*poi_max_travel;
+
+    if(poi_min_distance<=influence_distance)
+      return false;
+  }
+
+  if(verbose_>0)
+    ROS_ERROR_STREAM("connection far from the obstacles, scaling factor 1.0 without sampling");
+
+  quick_accepts_++;
+  return true;
+}
+
+unsigned int SSM15066Estimator::computeSamplesToSkip(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                                     const Eigen::VectorXd& dq, const Eigen::VectorXd& delta_q)
+{
+  double poi_distance, margin, poi_max_speed, poi_max_travel;
+  unsigned int samples_to_skip = std::numeric_limits<unsigned int>::max();
+
+  for(Eigen::Index i_poi=0;i_poi<poi_positions.cols();i_poi++)
+  {
+    /* Row by row, so that no temporary vector is allocated */
+    poi_max_speed  = poi_levers_.row(i_poi).dot(dq.cwiseAbs());
+    poi_max_travel = poi_levers_.row(i_poi).dot(delta_q.cwiseAbs());
+
+    poi_distance = computeDistanceFromObstacles(poi_positions.col(i_poi));
+
+    margin = poi_distance-computeInfluenceDistance(poi_max_speed/(1.0+adaptive_sampling_tolerance_));
+    if(margin<=0.0)
+      return 0;
+
+    if(poi_max_travel>0.0)
+      samples_to_skip = std::min(samples_to_skip,(unsigned int) std::min(std::floor(margin/poi_max_travel),(double) samples_to_skip));
+  }
+
+  return samples_to_skip;
+}
+
+unsigned int SSM15066Estimator::computeSamplesToSkip(const double& min_distance, const Eigen::VectorXd& dq, const Eigen::VectorXd& delta_q)
+{
+  /* The norm of a poi twist is bounded by the linear velocity bound plus the sum of the joints speeds */
+  double max_speed = 0.0;
+  double max_travel = 0.0;
+  for(Eigen::Index i_poi=0;i_poi<poi_levers_.rows();i_poi++)
+  {
+    max_speed  = std::max(max_speed ,poi_levers_.row(i_poi).dot(dq.cwiseAbs()));
+    max_travel = std::max(max_travel,poi_levers_.row(i_poi).dot(delta_q.cwiseAbs()));
+  }
+  max_speed += dq.cwiseAbs().sum();
+
+  double margin = min_distance-computeInfluenceDistance(max_speed/(1.0+adaptive_sampling_tolerance_));
+  if(margin<=0.0)
+    return 0;
+
+  if(max_travel<=0.0)
+    return std::numeric_limits<unsigned int>::max();
+
+  return (unsigned int) std::min(std::floor(margin/max_travel),(double) std::numeric_limits<unsigned int>::max());
+}
+
+bool SSM15066Estimator::mayHaveInfiniteSample(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const unsigned int& iter)
+{
+  Eigen::VectorXd& q = workspace.q;
+  Eigen::VectorXd& delta_q = workspace.delta_q;
+  Eigen::Matrix<double,3,Eigen::Dynamic>& poi_positions = workspace.poi_positions;
+
+  delta_q = workspace.connection_vector/iter;
+  poi_positions.resize(3,poi_idxs_.size());
+
+  /* The safe velocity is zero at distances not higher than the influence distance of a still poi */
+  double infinite_distance = computeInfluenceDistance(0.0);
+
+  double margin, poi_max_travel;
+  unsigned int samples_to_skip;
+  for(unsigned int i=0;i<iter+1;i+=samples_to_skip+1)
+  {
+    q = q1+i*delta_q;
+    poi_kinematics_.computePositions(chain,q,poi_positions);
+
+    samples_to_skip = iter;
+    for(Eigen::Index i_poi=0;i_poi<poi_positions.cols();i_poi++)
+    {
+      margin = computeDistanceFromObstacles(poi_positions.col(i_poi))-infinite_distance;
+      if(margin<=0.0)
+        return true;
+
+      /* Row by row, so that no temporary vector is allocated */
+      poi_max_travel = poi_levers_.row(i_poi).dot(delta_q.cwiseAbs());
+      if(poi_max_travel>0.0)
+        samples_to_skip = std::min(samples_to_skip,(unsigned int) std::min(std::floor(margin/poi_max_travel),(double) iter));
+    }
+  }
+
+  return false;
 }
+
+void SSM15066Estimator::increaseAnytimeLevel(AnytimeEvaluation& evaluation)
+{
+  std::chrono::steady_clock::time_point tic = std::chrono::steady_clock::now();
+  unsigned int first_sample, sample_stride;
+  if(evaluation.scene_version_ != scene_version_)
+  {
+    /* The samples evaluated before are outdated */
+    evaluation.scene_version_ = scene_version_;
+    evaluation.level_ = 0;
+    evaluation.sum_scaling_factor_ = 0.0;
+    evaluation.estimated_error_ = std::numeric_limits<double>::max();
+
+    first_sample = 0;
+    sample_stride = 1;
+  }
+  else
+  {
+    /* The new samples are the midpoints of the previous level */
+    evaluation.level_++;
+
+    first_sample = 1;
+    sample_stride = 2;
+  }
+
+  unsigned int n_intervals = 1u<<evaluation.level_;
+  unsigned int n_samples = 0;
+  double max_scaling_factor_of_q;
+
+  for(unsigned int i=first_sample;i<=n_intervals;i+=sample_stride)
+  {
+    workspace_.q = evaluation.q1_+(((double) i)/n_intervals)*(evaluation.q2_-evaluation.q1_);
+    max_scaling_factor_of_q = computeScalingFactorOfSample(workspace_.q,evaluation.dq_);
+    n_samples++;
+
+    if(max_scaling_factor_of_q == std::numeric_limits<double>::infinity())
+    {
+      evaluation.scaling_factor_ = std::numeric_limits<double>::infinity();
+      evaluation.estimated_error_ = 0.0;
+      evaluation.time_per_sample_ = std::chrono::duration<double>(std::chrono::steady_clock::now()-tic).count()/n_samples;
+      return;
+    }
+
+    evaluation.sum_scaling_factor_ += max_scaling_factor_of_q;
+  }
+
+  evaluation.time_per_sample_ = std::chrono::duration<double>(std::chrono::steady_clock::now()-tic).count()/n_samples;
+
+  double scaling_factor = evaluation.sum_scaling_factor_/((double) n_intervals+1);
+  if(evaluation.level_>0)
+    evaluation.estimated_error_ = std::abs(scaling_factor-evaluation.scaling_factor_);
+
+  evaluation.scaling_factor_ = scaling_factor;
+
+  if(verbose_>0)
+    ROS_ERROR_STREAM("level "<<evaluation.level_<<"/"<<evaluation.max_level_<<" scaling factor "<<evaluation.scaling_factor_<<" error "<<evaluation.estimated_error_);
+}
+
+AnytimeEvaluationPtr SSM15066Estimator::startAnytimeEvaluation(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const unsigned int& initial_level)
+{
+  AnytimeEvaluationPtr evaluation = std::make_shared<AnytimeEvaluation>();
+
+  /* Same joints velocity of the sampling, see computeScalingFactor */
+  Eigen::VectorXd connection_vector = q2-q1;
+  double slowest_joint_time = (inv_max_speed_.cwiseProduct(connection_vector)).cwiseAbs().maxCoeff();
+
+  evaluation->q1_ = q1;
+  evaluation->q2_ = q2;
+  evaluation->dq_ = connection_vector/slowest_joint_time;
+
+  /* The finest level has at least the samples of the uniform sampling */
+  unsigned int iter = std::max(std::ceil(connection_vector.norm()/max_step_size_),1.0);
+  evaluation->max_level_ = 0;
+  while((1u<<evaluation->max_level_)<iter)
+    evaluation->max_level_++;
+
+  /* Force the evaluation of the first level */
+  evaluation->scene_version_ = scene_version_+1;
+  evaluation->scaling_factor_ = 1.0;
+  increaseAnytimeLevel(*evaluation);
+
+  while(evaluation->level_<std::min(initial_level,evaluation->max_level_) && not evaluation->isComplete())
+    increaseAnytimeLevel(*evaluation);
+
+  return evaluation;
+}
+
+bool SSM15066Estimator::refineAnytimeEvaluation(const AnytimeEvaluationPtr& evaluation, const double& target_error, const double& time_budget)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  double elapsed = 0.0;
+  unsigned int n_new_samples;
+
+  /* If the scene has changed, the first level is evaluated again */
+  if(evaluation->scene_version_ != scene_version_)
+    increaseAnytimeLevel(*evaluation);
+
+  while(not evaluation->isComplete() && evaluation->estimated_error_>target_error)
+  {
+    /* Each level has as many new samples as the samples of the previous level minus one, their time is predicted from the last level
+     * evaluated (also by startAnytimeEvaluation), so that a budget shorter than a level does not start it */
+    n_new_samples = 1u<<evaluation->level_;
+    if(elapsed+evaluation->time_per_sample_*n_new_samples>time_budget)
+      break;
+
+    increaseAnytimeLevel(*evaluation);
+
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+  }
+
+  return evaluation->isComplete() || evaluation->estimated_error_<=target_error;
+}
+
+void SSM15066Estimator::computePathSampling(const pathplan::Waypoints& waypoints, std::vector<Eigen::VectorXd>& dqs,
+                                            std::vector<Eigen::VectorXd>& delta_qs, std::vector<unsigned int>& n_samples)
+{
+  size_t n_connections = std::max(waypoints.size(),(size_t) 1)-1;
+  dqs.resize(n_connections);
+  delta_qs.resize(n_connections);
+  n_samples.assign(n_connections,0);
+
+  Eigen::VectorXd connection_vector;
+  for(size_t i=0;i<n_connections;i++)
+  {
+    if(waypoints[i] == waypoints[i+1])
+      continue;
+
+    connection_vector = waypoints[i+1]-waypoints[i];
+    double slowest_joint_time = (inv_max_speed_.cwiseProduct(connection_vector)).cwiseAbs().maxCoeff();
+    unsigned int iter = std::max(std::ceil(connection_vector.norm()/max_step_size_),1.0);
+
+    dqs[i] = connection_vector/slowest_joint_time;
+    delta_qs[i] = connection_vector/iter;
+    n_samples[i] = iter+1;
+  }
+}
+
+std::vector<double> SSM15066Estimator::computePathScalingFactors(const pathplan::Waypoints& waypoints)
+{
+  std::vector<double> scaling_factors(std::max(waypoints.size(),(size_t) 1)-1,1.0);
+
+  /* Coincident waypoints have scaling factor 1.0 */
+  std::vector<size_t> idxs;
+  pathplan::ConfigurationsPairs connections;
+  for(size_t i=0;i<scaling_factors.size();i++)
+  {
+    if(waypoints[i] != waypoints[i+1])
+    {
+      idxs.push_back(i);
+      connections.push_back(pathplan::ConfigurationsPair(waypoints[i],waypoints[i+1]));
+    }
+  }
+
+  std::vector<double> connections_scaling_factors = computeScalingFactors(connections);
+  for(size_t j=0;j<idxs.size();j++)
+    scaling_factors[idxs[j]] = connections_scaling_factors[j];
+
+  return scaling_factors;
+}
+
+EdgeKinematicsPtr SSM15066Estimator::createEdgeKinematics(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  EdgeKinematicsPtr kinematics = std::make_shared<EdgeKinematics>();
+
+  /* Same sampling of the estimators, see computeScalingFactor */
+  Eigen::VectorXd connection_vector = (q2-q1);
+  double slowest_joint_time = (inv_max_speed_.cwiseProduct(connection_vector)).cwiseAbs().maxCoeff();
+  unsigned int iter = std::max(std::ceil((connection_vector).norm()/max_step_size_),1.0);
+
+  kinematics->q1_ = q1;
+  kinematics->q2_ = q2;
+  kinematics->dq_ = connection_vector/slowest_joint_time;
+  kinematics->n_samples_ = iter+1;
+  kinematics->n_pois_ = poi_idxs_.size();
+
+  unsigned int n_cols = kinematics->n_samples_*kinematics->n_pois_;
+  kinematics->poi_positions_  .resize(3,n_cols);
+  kinematics->poi_velocities_ .resize(3,n_cols);
+  kinematics->poi_twist_norms_.resize(n_cols);
+
+  return kinematics;
+}
+
+void SSM15066Estimator::computeEdgeKinematicsSamples(const rosdyn::ChainPtr& chain, Workspace& workspace, EdgeKinematics& kinematics,
+                                                     const unsigned int& first, const unsigned int& last)
+{
+  workspace.delta_q = (kinematics.q2_-kinematics.q1_)/(kinematics.n_samples_-1);
+  unsigned int col;
+
+  for(unsigned int i=first;i<last;i++)
+  {
+    workspace.q = kinematics.q1_+i*workspace.delta_q;
+
+    col = i*kinematics.n_pois_;
+    poi_kinematics_.computePositionsAndVelocities(chain,workspace.q,kinematics.dq_,
+                                                  kinematics.poi_positions_  .middleCols(col,kinematics.n_pois_),
+                                                  kinematics.poi_velocities_ .middleCols(col,kinematics.n_pois_),
+                                                  kinematics.poi_twist_norms_.segment(col,kinematics.n_pois_));
+  }
+}
+
+EdgeKinematicsPtr SSM15066Estimator::computeEdgeKinematics(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  EdgeKinematicsPtr kinematics = createEdgeKinematics(q1,q2);
+  computeEdgeKinematicsSamples(chain_,workspace_,*kinematics,0,kinematics->n_samples_);
+
+  return kinematics;
+}
+
+EdgeKinematicsPtr SSM15066Estimator::getEdgeKinematics(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  assert(kinematics_store_);
+
+  EdgeKinematicsPtr kinematics = kinematics_store_->find(q1,q2);
+  if(not kinematics)
+  {
+    kinematics = computeEdgeKinematics(q1,q2);
+    kinematics_store_->insert(kinematics);
+  }
+
+  return kinematics;
+}
+
+EdgeKinematicsPtr SSM15066Estimator::getEdgeKinematics(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  assert(kinematics_store_);
+
+  /* Two threads may compute the same connection at the same time, the last insertion replaces the first one */
+  EdgeKinematicsPtr kinematics = kinematics_store_->find(q1,q2);
+  if(not kinematics)
+  {
+    kinematics = createEdgeKinematics(q1,q2);
+    computeEdgeKinematicsSamples(chain,workspace,*kinematics,0,kinematics->n_samples_);
+    kinematics_store_->insert(kinematics);
+  }
+
+  return kinematics;
+}
+
+void SSM15066Estimator::copySettingsTo(SSM15066Estimator& other)
+{
+  other.setPoiNames(poi_names_);
+  other.setMaxStepSize(max_step_size_);
+  other.setObstaclesPositions(obstacles_positions_);
+  other.setObstaclesIndexThreshold(obstacles_index_threshold_);
+
+  other.setMaxCartAcc(max_cart_acc_,false);
+  other.setMinDistance(min_distance_,false);
+  other.setReactionTime(reaction_time_,false);
+  other.setHumanVelocity(human_velocity_,false);
+
+  other.updateMembers();
+
+  other.setAdaptiveSampling(adaptive_sampling_,adaptive_sampling_tolerance_);
+  other.setQuickAccept(quick_accept_);
+  other.setQuadrature(quadrature_,quadrature_absolute_tolerance_,quadrature_relative_tolerance_);
+  other.setInstructionSet(getInstructionSet());
+
+  DistanceFieldPtr distance_field = getDistanceField();
+  if(distance_field)
+    other.setDistanceField(distance_field->getMinCorner(),distance_field->getMaxCorner(),distance_field->getResolution());
+  else
+    other.disableDistanceField();
+
+  if(kinematics_store_)
+    other.enableKinematicsStore(kinematics_store_->getCapacity(),kinematics_store_->getResolution());
+  else
+    other.disableKinematicsStore();
+}
+
 }
@@ -33,22 +33,50 @@ SSM15066Estimator1D::SSM15066Estimator1D(const rosdyn::ChainPtr &chain, const do
   SSM15066Estimator(chain,max_step_size)
 {
   min_distance_solver_ = std::make_shared<MinDistanceSolver>(chain);
+  min_poi_speed_ = 1e-02;
+  distance_from_pois_only_ = false;
+
+  updatePoiIdxs();
 }
 
 SSM15066Estimator1D::SSM15066Estimator1D(const rosdyn::ChainPtr &chain, const double &max_step_size, const Eigen::Matrix<double,3,Eigen::Dynamic> &obstacles_positions):
   SSM15066Estimator(chain,max_step_size,obstacles_positions)
 {
   min_distance_solver_ = std::make_shared<MinDistanceSolver>(chain,obstacles_positions);
+  min_poi_speed_ = 1e-02;
+  distance_from_pois_only_ = false;
+
+  updatePoiIdxs();
+}
+
+void SSM15066Estimator1D::updatePoiIdxs()
+{
+  /* The kinematics of all the links is computed to measure the minimum distance, but the speeds of the pois only are considered */
+  const std::vector<std::string>& frames = distance_from_pois_only_? poi_names_: frames_names_;
+
+  poi_kinematics_.setPoiNames(frames_names_,frames);
+  poi_idxs_ = poi_kinematics_.getPoiIdxs();
+  updatePoiLevers();
+
+  min_distance_solver_->setPoiNames(frames);
+
+  is_poi_.resize(poi_idxs_.size());
+  for(size_t i=0;i<poi_idxs_.size();i++)
+    is_poi_[i] = (std::find(poi_names_.begin(),poi_names_.end(),frames_names_[poi_idxs_[i]])<poi_names_.end());
 }
 
 void SSM15066Estimator1D::addObstaclePosition(const Eigen::Vector3d& obstacle_position)
 {
+  waitForSubmittedPenalties();
+
   SSM15066Estimator::addObstaclePosition(obstacle_position);
   min_distance_solver_->addObstaclePosition(obstacle_position);
 }
 
 void SSM15066Estimator1D::setObstaclesPositions(const Eigen::Matrix<double,3,Eigen::Dynamic>& obstacles_positions)
 {
+  waitForSubmittedPenalties();
+
   SSM15066Estimator::setObstaclesPositions(obstacles_positions);
   min_distance_solver_->setObstaclesPositions(obstacles_positions);
 }
@@ -59,81 +87,107 @@ double SSM15066Estimator1D::computeScalingFactor(const Eigen::VectorXd& q1, cons
   if(obstacles_positions_.cols()==0)  //no obstacles in the scene
     return 1.0;
 
+  if(kinematics_store_)
+    return computeScalingFactorFromKinematics(*getEdgeKinematics(q1,q2));
+
+  return computeScalingFactor(chain_,min_distance_solver_,workspace_,q1,q2);
+}
+
+std::vector<double> SSM15066Estimator1D::computeScalingFactors(const pathplan::ConfigurationsPairs& connections)
+{
+  assert(obstacles_positions_ == min_distance_solver_->getObstaclesPositions());
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return std::vector<double>(connections.size(),1.0);
+
+  std::vector<double> scaling_factors;
+  scaling_factors.reserve(connections.size());
+
+  for(const pathplan::ConfigurationsPair& connection:connections)
+  {
+    if(kinematics_store_)
+      scaling_factors.push_back(computeScalingFactorFromKinematics(*getEdgeKinematics(connection.first,connection.second)));
+    else
+      scaling_factors.push_back(computeScalingFactor(chain_,min_distance_solver_,workspace_,connection.first,connection.second));
+  }
+
+  return scaling_factors;
+}
+
+double SSM15066Estimator1D::computeScalingFactorBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor)
+{
+  assert(obstacles_positions_ == min_distance_solver_->getObstaclesPositions());
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return 1.0;
+
+  if(kinematics_store_)
+    return computeScalingFactorFromKinematics(*getEdgeKinematics(q1,q2));
+
+  return computeScalingFactor(chain_,min_distance_solver_,workspace_,q1,q2,max_scaling_factor);
+}
+
+double SSM15066Estimator1D::computeScalingFactor(const rosdyn::ChainPtr& chain, const MinDistanceSolverPtr& min_distance_solver, Workspace& workspace,
+                                                 const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor)
+{
+  if(quick_accept_ && isFarFromObstacles(chain,workspace,q1,q2,true))
+    return 1.0;
+
+  if(quadrature_)
+  {
+    return integrateScalingFactor([this,&chain,&min_distance_solver,&workspace](const Eigen::VectorXd& q) ->double{
+      double min_distance;
+      return computeScalingFactorAtQ(chain,min_distance_solver,workspace,q,workspace.dq,min_distance);
+    },chain,workspace,q1,q2,max_scaling_factor);
+  }
+
+  /* The buffers of the workspace are allocated at the first call only */
+  Eigen::VectorXd& q = workspace.q;
+  Eigen::VectorXd& dq = workspace.dq;
+  Eigen::VectorXd& delta_q = workspace.delta_q;
+
   double sum_scaling_factor = 0.0;
 
-  double min_distance, velocity, scaling_factor, max_scaling_factor_of_q, v_safety;
-  std::vector< Eigen::Vector6d, Eigen::aligned_allocator<Eigen::Vector6d>> poi_twist_in_base;
+  double min_distance, max_scaling_factor_of_q;
 
   /* Compute the time of each joint to move from q1 to q2 at its maximum speed and consider the longest time */
   double slowest_joint_time = (inv_max_speed_.cwiseProduct(q2 - q1)).cwiseAbs().maxCoeff();
 
   /* The "slowest" joint will move at its highest speed while the other ones will
    * move at (t_i/slowest_joint_time)*max_speed_i, where slowest_joint_time >= t_i */
-  Eigen::VectorXd dq = (q2-q1)/slowest_joint_time;
+  dq = (q2-q1)/slowest_joint_time;
 
   unsigned int iter = std::max(std::ceil((q2-q1).norm()/max_step_size_),1.0);
 
-  Eigen::VectorXd q;
-  Eigen::VectorXd delta_q = (q2-q1)/iter;
+  delta_q = (q2-q1)/iter;
+
+  unsigned int samples_to_skip = 0;
 
   for(unsigned int i=0;i<iter+1;i++)
   {
     q = q1+i*delta_q;
-    max_scaling_factor_of_q = 1.0;
 
-    poi_twist_in_base = chain_->getTwist(q,dq);
-    min_distance = min_distance_solver_->computeMinDistance(q)->distance_;
-
-    if(verbose_)
+    if(samples_to_skip>0) // the scaling factor is provably not higher than 1+adaptive_sampling_tolerance_, see setAdaptiveSampling
     {
-      ROS_ERROR_STREAM("--- q -> "<<q.transpose()<<" ---");
-      ROS_ERROR_STREAM("distance -> "<<min_distance);
-    }
+      samples_to_skip--;
+      sum_scaling_factor += 1.0;
 
-    v_safety = safeVelocity(min_distance);
+      if((sum_scaling_factor+(iter-i))/((double) iter+1)>max_scaling_factor)
+        return (sum_scaling_factor+(iter-i))/((double) iter+1);
 
-    if(verbose_)
-      ROS_ERROR_STREAM("v_safe -> "<<v_safety);
+      continue;
+    }
 
-    if(v_safety == 0.0)
+    max_scaling_factor_of_q = computeScalingFactorAtQ(chain,min_distance_solver,workspace,q,dq,min_distance);
+    if(max_scaling_factor_of_q == std::numeric_limits<double>::infinity())
       return std::numeric_limits<double>::infinity();
 
-    for(size_t i_poi=0;i_poi<poi_twist_in_base.size();i_poi++)
-    {
-      //consider only links inside the poi_names_ list
-      if(std::find(poi_names_.begin(),poi_names_.end(),frames_names_[i_poi])>=poi_names_.end())
-        continue;
-
-      velocity = poi_twist_in_base[i_poi].norm();
-
-      if(velocity<1e-02)
-      {
-        scaling_factor = 1.0;
-      }
-      else if(min_distance>min_distance_)
-      {
-        scaling_factor = std::max(velocity/v_safety,1.0); // no division by 0
-      }
-      else  // distance<=min_distance -> you have found the maximum scaling factor, return
-      {
-        if(verbose_)
-          ROS_ERROR_STREAM("below safe distance! ");
-
-        return std::numeric_limits<double>::infinity();  //if one point q has 0.0 scaling factor, return it
-      }
-
-      if(verbose_)
-        ROS_ERROR_STREAM("poi "<<i_poi<<" velocity ->"<<velocity<<" scaling ->"<<scaling_factor);
-
-      if(scaling_factor>max_scaling_factor_of_q)
-        max_scaling_factor_of_q = scaling_factor;
-
-    } // end robot poi for loop
+    sum_scaling_factor += max_scaling_factor_of_q;
 
-    if(verbose_)
-      ROS_ERROR_STREAM("max scaling of q "<<max_scaling_factor_of_q);
+    if(adaptive_sampling_)
+      samples_to_skip = computeSamplesToSkip(min_distance,dq,delta_q);
 
-    sum_scaling_factor += max_scaling_factor_of_q;
+    /* Each remaining sample adds at least 1.0, stop if the average is already proven to be higher than the bound */
+    if((sum_scaling_factor+(iter-i))/((double) iter+1)>max_scaling_factor)
+      return (sum_scaling_factor+(iter-i))/((double) iter+1);
   }
   assert((q2-q).norm()<1e-08);
 
@@ -154,20 +208,144 @@ double SSM15066Estimator1D::computeScalingFactor(const Eigen::VectorXd& q1, cons
   return res;
 }
 
-pathplan::CostPenaltyPtr SSM15066Estimator1D::clone()
+double SSM15066Estimator1D::computeScalingFactorAtQ(const rosdyn::ChainPtr& chain, const MinDistanceSolverPtr& min_distance_solver, Workspace& workspace,
+                                                    const Eigen::VectorXd& q, const Eigen::VectorXd& dq, double& min_distance)
 {
-  SSM15066Estimator1DPtr cloned_ssm = std::make_shared<SSM15066Estimator1D>(chain_->clone(),max_step_size_,obstacles_positions_);
+  workspace.poi_positions  .resize(3,poi_idxs_.size());
+  workspace.poi_velocities .resize(3,poi_idxs_.size());
+  workspace.poi_twist_norms.resize(poi_idxs_.size());
 
-  cloned_ssm->setPoiNames(poi_names_);
-  cloned_ssm->setMaxStepSize(max_step_size_);
-  cloned_ssm->setObstaclesPositions(obstacles_positions_);
+  poi_kinematics_.computePositionsAndVelocities(chain,q,dq,workspace.poi_positions,workspace.poi_velocities,workspace.poi_twist_norms);
+  min_distance_solver->computeMinDistance(q,workspace.poi_positions,workspace.distance);
+  min_distance = workspace.distance.distance_;
 
-  cloned_ssm->setMaxCartAcc(max_cart_acc_,false);
-  cloned_ssm->setMinDistance(min_distance_,false);
-  cloned_ssm->setReactionTime(reaction_time_,false);
-  cloned_ssm->setHumanVelocity(human_velocity_,false);
+  if(verbose_)
+  {
+    ROS_ERROR_STREAM("--- q -> "<<q.transpose()<<" ---");
+    ROS_ERROR_STREAM("distance -> "<<min_distance);
+  }
 
-  cloned_ssm->updateMembers();
+  return computeScalingFactorAtDistance(min_distance,workspace.poi_twist_norms);
+}
+
+double SSM15066Estimator1D::computeScalingFactorOfSample(const Eigen::VectorXd& q, const Eigen::VectorXd& dq)
+{
+  double min_distance;
+  return computeScalingFactorAtQ(chain_,min_distance_solver_,workspace_,q,dq,min_distance);
+}
+
+double SSM15066Estimator1D::computeScalingFactorAtDistance(const double& min_distance, const Eigen::Ref<const Eigen::VectorXd>& poi_speeds)
+{
+  double velocity, scaling_factor;
+  double max_scaling_factor_of_q = 1.0;
+
+  double v_safety = safeVelocity(min_distance);
+
+  if(verbose_)
+    ROS_ERROR_STREAM("v_safe -> "<<v_safety);
+
+  if(v_safety == 0.0)
+    return std::numeric_limits<double>::infinity();
+
+  for(Eigen::Index i_poi=0;i_poi<poi_speeds.size();i_poi++)
+  {
+    if(not is_poi_[i_poi])  // a link used for the minimum distance only
+      continue;
+
+    velocity = poi_speeds(i_poi);
+
+    if(velocity<min_poi_speed_)
+    {
+      scaling_factor = 1.0;
+    }
+    else if(min_distance>min_distance_)
+    {
+      scaling_factor = std::max(velocity/v_safety,1.0); // no division by 0
+    }
+    else  // distance<=min_distance -> you have found the maximum scaling factor, return
+    {
+      if(verbose_)
+        ROS_ERROR_STREAM("below safe distance! ");
+
+      return std::numeric_limits<double>::infinity();  //if one point q has 0.0 scaling factor, return it
+    }
+
+    if(verbose_)
+      ROS_ERROR_STREAM("poi "<<i_poi<<" velocity ->"<<velocity<<" scaling ->"<<scaling_factor);
+
+    if(scaling_factor>max_scaling_factor_of_q)
+      max_scaling_factor_of_q = scaling_factor;
+
+  } // end robot poi for loop
+
+  if(verbose_)
+    ROS_ERROR_STREAM("max scaling of q "<<max_scaling_factor_of_q);
+
+  return max_scaling_factor_of_q;
+}
+
+double SSM15066Estimator1D::computeScalingFactorFromKinematics(const EdgeKinematics& kinematics)
+{
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return 1.0;
+
+  assert(kinematics.n_pois_ == poi_idxs_.size());
+
+  unsigned int col;
+  double min_distance, max_scaling_factor_of_q;
+  double sum_scaling_factor = 0.0;
+
+  for(unsigned int i=0;i<kinematics.n_samples_;i++)
+  {
+    col = i*kinematics.n_pois_;
+
+    /* Same as MinDistanceSolver::computeMinDistance, using the stored pois positions */
+    min_distance = std::numeric_limits<double>::infinity();
+    if(useObstaclesIndex())
+    {
+      double poi_distance;
+      for(unsigned int i_poi=0;i_poi<kinematics.n_pois_;i_poi++)
+      {
+        obstacles_index_->nearest(kinematics.poi_positions_.col(col+i_poi),poi_distance);
+        min_distance = std::min(min_distance,poi_distance);
+      }
+    }
+    else
+    {
+      for(Eigen::Index i_obs=0;i_obs<obstacles_positions_.cols();i_obs++)
+      {
+        for(unsigned int i_poi=0;i_poi<kinematics.n_pois_;i_poi++)
+          min_distance = std::min(min_distance,(obstacles_positions_.col(i_obs)-kinematics.poi_positions_.col(col+i_poi)).norm());
+      }
+    }
+
+    max_scaling_factor_of_q = computeScalingFactorAtDistance(min_distance,kinematics.poi_twist_norms_.segment(col,kinematics.n_pois_));
+    if(max_scaling_factor_of_q == std::numeric_limits<double>::infinity())
+      return std::numeric_limits<double>::infinity();
+
+    sum_scaling_factor += max_scaling_factor_of_q;
+  }
+
+  // return the average scaling factor
+  double res = sum_scaling_factor/((double) kinematics.n_samples_);
+  assert(res>=1.0);
+
+  return res;
+}
+
+void SSM15066Estimator1D::copySettingsTo(SSM15066Estimator& other)
+{
+  SSM15066Estimator::copySettingsTo(other);
+
+  SSM15066Estimator1D& other_1d = static_cast<SSM15066Estimator1D&>(other);
+  other_1d.setDistanceFromPoisOnly(distance_from_pois_only_);
+  other_1d.setMinPoiSpeed(min_poi_speed_);
+}
+
+pathplan::CostPenaltyPtr SSM15066Estimator1D::clone()
+{
+  SSM15066Estimator1DPtr cloned_ssm = std::make_shared<SSM15066Estimator1D>(chain_->clone(),max_step_size_,obstacles_positions_);
+  copySettingsTo(*cloned_ssm);
 
   pathplan::CostPenaltyPtr clone = cloned_ssm;
 
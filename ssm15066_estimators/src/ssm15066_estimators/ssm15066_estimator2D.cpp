@@ -48,13 +48,172 @@ double SSM15066Estimator2D::computeScalingFactor(const Eigen::VectorXd& q1, cons
       ROS_ERROR_STREAM("obs location -> "<<obstacles_positions_.col(i).transpose());
   }
 
+  if(kinematics_store_)
+    return computeScalingFactorFromKinematics(*getEdgeKinematics(q1,q2));
+
+  return computeScalingFactor(chain_,workspace_,q1,q2);
+}
+
+double SSM15066Estimator2D::computeScalingFactorBounded(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2, const double& max_scaling_factor)
+{
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return 1.0;
+
+  if(kinematics_store_)
+    return computeScalingFactorFromKinematics(*getEdgeKinematics(q1,q2));
+
+  return computeScalingFactor(chain_,workspace_,q1,q2,max_scaling_factor);
+}
+
+std::vector<double> SSM15066Estimator2D::computeScalingFactors(const pathplan::ConfigurationsPairs& connections)
+{
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return std::vector<double>(connections.size(),1.0);
+
+  std::vector<double> scaling_factors;
+  scaling_factors.reserve(connections.size());
+
+  for(const pathplan::ConfigurationsPair& connection:connections)
+  {
+    if(kinematics_store_)
+      scaling_factors.push_back(computeScalingFactorFromKinematics(*getEdgeKinematics(connection.first,connection.second)));
+    else
+      scaling_factors.push_back(computeScalingFactor(chain_,workspace_,connection.first,connection.second));
+  }
+
+  return scaling_factors;
+}
+
+bool SSM15066Estimator2D::arePoisFarFromObstacles(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                                  const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                                                  const double& position_margin, const double& speed_margin)
+{
+  double influence_distance, lower_bound;
+  for(Eigen::Index i_poi=0;i_poi<poi_positions.cols();i_poi++)
+  {
+    /* Farther obstacles than the influence distance have a safe velocity higher than the poi speed (see computeInfluenceDistance) */
+    influence_distance = computeInfluenceDistance(poi_velocities.col(i_poi).norm()+speed_margin)+position_margin;
+
+    if(distance_field_ && distance_field_->lowerBound(poi_positions.col(i_poi),lower_bound) && lower_bound>influence_distance)
+      continue;
+
+    if(computeDistanceFromObstacles(poi_positions.col(i_poi))<=influence_distance)
+      return false;
+  }
+
+  return true;
+}
+
+std::pair<double,double> SSM15066Estimator2D::computeScalingFactorBothWays(const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return std::make_pair(1.0,1.0);
+
+  if(kinematics_store_)
+    return std::make_pair(computeScalingFactorFromKinematics(*getEdgeKinematics(q1,q2)),computeScalingFactorFromKinematics(*getEdgeKinematics(q2,q1)));
+
+  return computeScalingFactorBothWays(chain_,workspace_,q1,q2);
+}
+
+double SSM15066Estimator2D::computeScalingFactor(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                                                 const double& max_scaling_factor)
+{
+  if(quick_accept_ && isFarFromObstacles(chain,workspace,q1,q2,false))
+    return 1.0;
+
+  if(quadrature_)
+  {
+    return integrateScalingFactor([this,&chain,&workspace](const Eigen::VectorXd& q) ->double{
+      computePoiKinematics(chain,q,workspace.dq,workspace.poi_positions,workspace.poi_velocities);
+      return computeMaxScalingFactorAtPois(workspace.poi_positions,workspace.poi_velocities,workspace.obstacles_idxs);
+    },chain,workspace,q1,q2,max_scaling_factor);
+  }
+
+  if(kinematics_interpolation_)
+    return computeScalingFactorInterpolated(chain,workspace,q1,q2,max_scaling_factor);
+
+  return computeScalingFactorUniform(chain,workspace,q1,q2,max_scaling_factor);
+}
+
+double SSM15066Estimator2D::computeScalingFactorUniform(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                                                        const double& max_scaling_factor)
+{
+  unsigned int iter = setUniformSampling(workspace,q1,q2);
+
+  double max_scaling_factor_of_q;
+  double sum_scaling_factor = 0.0;
+  unsigned int samples_to_skip = 0;
+
+  for(unsigned int i=0;i<iter+1;i++)
+  {
+    workspace.q = q1+i*workspace.delta_q;
+
+    if(samples_to_skip>0) // the scaling factor is provably not higher than 1+adaptive_sampling_tolerance_, see setAdaptiveSampling
+    {
+      samples_to_skip--;
+      sum_scaling_factor += 1.0;
+    }
+    else
+    {
+      computePoiKinematics(chain,workspace.q,workspace.dq,workspace.poi_positions,workspace.poi_velocities);
+      max_scaling_factor_of_q = computeMaxScalingFactorAtPois(workspace.poi_positions,workspace.poi_velocities,workspace.obstacles_idxs);
+
+      if(max_scaling_factor_of_q == std::numeric_limits<double>::infinity())
+        return std::numeric_limits<double>::infinity();
+      else
+        sum_scaling_factor += max_scaling_factor_of_q;
+
+      if(verbose_>0)
+      {
+        ROS_ERROR_STREAM("q "<<workspace.q.transpose()<<" -> scaling factor "<<max_scaling_factor_of_q);
+        ROS_ERROR("-------- END q -----------");
+      }
+
+      if(adaptive_sampling_)
+        samples_to_skip = computeSamplesToSkip(workspace.poi_positions,workspace.dq,workspace.delta_q);
+    }
+
+    /* Each remaining sample adds at least 1.0, stop if the average is already proven to be higher than the bound */
+    if((sum_scaling_factor+(iter-i))/((double) iter+1)>max_scaling_factor)
+    {
+      if(verbose_>0)
+        ROS_ERROR_STREAM("scaling factor higher than "<<max_scaling_factor<<", stop at sample "<<i<<"/"<<iter);
+
+      return (sum_scaling_factor+(iter-i))/((double) iter+1);
+    }
+  }
+
+  // return the average scaling factor
+  double res = sum_scaling_factor/((double) iter+1);
+  assert([&]() ->bool{
+           if(res>=1.0)
+           {
+             return true;
+           }
+           else
+           {
+             ROS_INFO_STREAM("Scaling factor "<<res<<" sum "<<sum_scaling_factor<<" denominator "<<iter+1);
+             return false;
+           }
+         }());
+
+  return res;
+}
+
+unsigned int SSM15066Estimator2D::setUniformSampling(Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  /* The buffers of the workspace are allocated at the first call only */
+  Eigen::VectorXd& dq = workspace.dq;
+  Eigen::VectorXd& delta_q = workspace.delta_q;
+  Eigen::VectorXd& connection_vector = workspace.connection_vector;
+
   /* Compute the time of each joint to move from q1 to q2 at its maximum speed and consider the longest time */
-  Eigen::VectorXd connection_vector = (q2-q1);
+  connection_vector = (q2-q1);
   double slowest_joint_time = (inv_max_speed_.cwiseProduct(connection_vector)).cwiseAbs().maxCoeff();
 
   /* The "slowest" joint will move at its highest speed while the other ones will
    * move at (t_i/slowest_joint_time)*max_speed_i, where slowest_joint_time >= t_i */
-  Eigen::VectorXd dq = connection_vector/slowest_joint_time;
+  dq = connection_vector/slowest_joint_time;
 
   assert([&]() ->bool{
            Eigen::VectorXd q_v  = connection_vector/connection_vector.norm();
@@ -79,36 +238,17 @@ double SSM15066Estimator2D::computeScalingFactor(const Eigen::VectorXd& q1, cons
 
   unsigned int iter = std::max(std::ceil((connection_vector).norm()/max_step_size_),1.0);
 
-  Eigen::VectorXd q;
-  Eigen::VectorXd delta_q = connection_vector/iter;
-
-  double max_scaling_factor_of_q;
-  double sum_scaling_factor = 0.0;
-  Eigen::Vector3d this_poi_position;
-  double this_distance, this_speed, this_safe_vel;
-
-  for(unsigned int i=0;i<iter+1;i++)
-  {
-    q = q1+i*delta_q;
-
-    max_scaling_factor_of_q = computeScalingFactorAtQ(q,dq,this_speed,this_distance,this_safe_vel,this_poi_position);
-    if(max_scaling_factor_of_q == std::numeric_limits<double>::infinity())
-      return std::numeric_limits<double>::infinity();
-    else
-      sum_scaling_factor += max_scaling_factor_of_q;
-  }
+  delta_q = connection_vector/iter;
 
   assert([&]() ->bool{
-           double err = (q2-q).norm();
+           double err = (q2-(q1+iter*delta_q)).norm();
            if(err<1e-03)
            {
              return true;
            }
            else
            {
-             ROS_INFO_STREAM("error "<<err<<" q "<<q.transpose()<<" q2 "<<q2.transpose());
-             ROS_INFO_STREAM("q2-q1/step size "<<std::ceil((connection_vector).norm()/max_step_size_));
-             ROS_INFO_STREAM("ceil "<<std::ceil((connection_vector).norm()/max_step_size_));
+             ROS_INFO_STREAM("error "<<err<<" q1 "<<q1.transpose()<<" q2 "<<q2.transpose());
              ROS_INFO_STREAM("iter "<<iter);
              ROS_INFO_STREAM("delta "<<delta_q.transpose());
 
@@ -116,23 +256,217 @@ double SSM15066Estimator2D::computeScalingFactor(const Eigen::VectorXd& q1, cons
            }
          }());
 
+  return iter;
+}
+
+double SSM15066Estimator2D::computeScalingFactorInterpolated(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const Eigen::VectorXd& q2,
+                                                             const double& max_scaling_factor)
+{
+  Eigen::VectorXd& q = workspace.q;
+  Eigen::VectorXd& dq = workspace.dq;
+  Eigen::VectorXd& delta_q = workspace.delta_q;
+  Eigen::VectorXd& connection_vector = workspace.connection_vector;
+
+  /* Kinematics at the previous anchor, at the next anchor and at the samples in between */
+  Eigen::Matrix<double,3,Eigen::Dynamic>& anchor_positions = workspace.poi_positions;
+  Eigen::Matrix<double,3,Eigen::Dynamic>& anchor_velocities = workspace.poi_velocities;
+  Eigen::Matrix<double,3,Eigen::Dynamic>& next_anchor_positions = workspace.next_poi_positions;
+  Eigen::Matrix<double,3,Eigen::Dynamic>& next_anchor_velocities = workspace.next_poi_velocities;
+  Eigen::Matrix<double,3,Eigen::Dynamic>& poi_positions = workspace.predicted_poi_positions;
+  Eigen::Matrix<double,3,Eigen::Dynamic>& poi_velocities = workspace.predicted_poi_velocities;
+
+  /* Same sampling of computeScalingFactor */
+  connection_vector = (q2-q1);
+  double slowest_joint_time = (inv_max_speed_.cwiseProduct(connection_vector)).cwiseAbs().maxCoeff();
+  dq = connection_vector/slowest_joint_time;
+
+  unsigned int iter = std::max(std::ceil((connection_vector).norm()/max_step_size_),1.0);
+  delta_q = connection_vector/iter;
+
+  /* Time between consecutive samples, the pois move by poi_velocities*sample_time from a sample to the next one */
+  double sample_time = slowest_joint_time/iter;
+
+  poi_positions .resize(3,poi_idxs_.size());
+  poi_velocities.resize(3,poi_idxs_.size());
+
+  double max_scaling_factor_of_q, anchor_scaling_factor, error, h, s, h00, h10, h01, h11;
+  bool interpolate;
+
+  unsigned int n_samples = iter+1;
+  unsigned int n_evaluated = 1;
+
+  q = q1;
+  computePoiKinematics(chain,q,dq,anchor_positions,anchor_velocities);
+  double sum_scaling_factor = computeMaxScalingFactorAtPois(anchor_positions,anchor_velocities,workspace.obstacles_idxs);
+  if(sum_scaling_factor == std::numeric_limits<double>::infinity())
+    return std::numeric_limits<double>::infinity();
+
+  for(unsigned int anchor=0,next_anchor;anchor<iter;anchor=next_anchor)
+  {
+    next_anchor = std::min(anchor+anchors_stride_,iter);
+
+    q = q1+next_anchor*delta_q;
+    computePoiKinematics(chain,q,dq,next_anchor_positions,next_anchor_velocities);
+    anchor_scaling_factor = computeMaxScalingFactorAtPois(next_anchor_positions,next_anchor_velocities,workspace.obstacles_idxs);
+    if(anchor_scaling_factor == std::numeric_limits<double>::infinity())
+      return std::numeric_limits<double>::infinity();
+
+    /* The chord between the anchors differs from the mean velocity times the segment time by ~h^3/12*|p'''|, while the errors of
+     * the Hermite positions and of the linear velocities are bounded by ~h^4/384*|p''''| and ~h^2/8*|p'''| */
+    h = sample_time*(next_anchor-anchor);
+    interpolate = (next_anchor-anchor>1);
+    for(Eigen::Index i_poi=0;i_poi<anchor_positions.cols() && interpolate;i_poi++)
+    {
+      error = ((next_anchor_positions.col(i_poi)-anchor_positions.col(i_poi))-0.5*h*(anchor_velocities.col(i_poi)+next_anchor_velocities.col(i_poi))).norm();
+      if(error>interpolation_position_tolerance_ || 1.5*error/h>interpolation_velocity_tolerance_)
+        interpolate = false;
+    }
+
+    for(unsigned int i=anchor+1;i<next_anchor;i++)
+    {
+      max_scaling_factor_of_q = std::numeric_limits<double>::infinity();
+
+      if(interpolate)
+      {
+        s = ((double) (i-anchor))/(next_anchor-anchor);
+        h00 = (2.0*s-3.0)*s*s+1.0;
+        h10 = ((s-2.0)*s+1.0)*s;
+        h01 = (3.0-2.0*s)*s*s;
+        h11 = (s-1.0)*s*s;
+
+        poi_positions  = h00*anchor_positions+(h10*h)*anchor_velocities+h01*next_anchor_positions+(h11*h)*next_anchor_velocities;
+        poi_velocities = (1.0-s)*anchor_velocities+s*next_anchor_velocities;
+
+        if(arePoisFarFromObstacles(poi_positions,poi_velocities,interpolation_position_tolerance_,interpolation_velocity_tolerance_))
+          max_scaling_factor_of_q = 1.0;
+      }
+
+      if(max_scaling_factor_of_q>1.0)  // not interpolated or possibly within the influence distance of an obstacle
+      {
+        q = q1+i*delta_q;
+        computePoiKinematics(chain,q,dq,poi_positions,poi_velocities);
+        max_scaling_factor_of_q = computeMaxScalingFactorAtPois(poi_positions,poi_velocities,workspace.obstacles_idxs);
+
+        if(max_scaling_factor_of_q == std::numeric_limits<double>::infinity())
+          return std::numeric_limits<double>::infinity();
+      }
+
+      sum_scaling_factor += max_scaling_factor_of_q;
+      n_evaluated++;
+
+      /* Each remaining sample adds at least 1.0, stop if the average is already proven to be higher than the bound */
+      if((sum_scaling_factor+(n_samples-n_evaluated))/((double) n_samples)>max_scaling_factor)
+        return (sum_scaling_factor+(n_samples-n_evaluated))/((double) n_samples);
+    }
+
+    sum_scaling_factor += anchor_scaling_factor;
+    n_evaluated++;
+
+    if((sum_scaling_factor+(n_samples-n_evaluated))/((double) n_samples)>max_scaling_factor)
+      return (sum_scaling_factor+(n_samples-n_evaluated))/((double) n_samples);
+
+    anchor_positions .swap(next_anchor_positions );
+    anchor_velocities.swap(next_anchor_velocities);
+  }
+
+  assert(n_evaluated == n_samples);
+
   // return the average scaling factor
-  double res = sum_scaling_factor/((double) iter+1);
-  assert([&]() ->bool{
-           if(res>=1.0)
-           {
-             return true;
-           }
-           else
-           {
-             ROS_INFO_STREAM("Scaling factor "<<res<<" sum "<<sum_scaling_factor<<" denominator "<<iter+1);
-             return false;
-           }
-         }());
+  double res = sum_scaling_factor/((double) n_samples);
+  assert(res>=1.0);
 
   return res;
 }
 
+std::pair<double,double> SSM15066Estimator2D::computeScalingFactorBothWays(const rosdyn::ChainPtr& chain, Workspace& workspace,
+                                                                           const Eigen::VectorXd& q1, const Eigen::VectorXd& q2)
+{
+  /* The interpolated and integrated samples depend on the direction */
+  if(quadrature_ || kinematics_interpolation_)
+  {
+    double forward_scaling_factor = computeScalingFactor(chain,workspace,q1,q2);
+    return std::make_pair(forward_scaling_factor,computeScalingFactor(chain,workspace,q2,q1));
+  }
+
+  /* The quick accept bounds the distances of the whole segment, whatever the direction */
+  if(quick_accept_ && isFarFromObstacles(chain,workspace,q1,q2,false))
+    return std::make_pair(1.0,1.0);
+
+  /* Same sampling of computeScalingFactor. Sample i of (q2,q1) is sample iter-i of (q1,q2) and the slowest joint time is the same,
+   * so the joints velocity of (q2,q1) is -dq */
+  workspace.connection_vector = q2-q1;
+  double slowest_joint_time = (inv_max_speed_.cwiseProduct(workspace.connection_vector)).cwiseAbs().maxCoeff();
+  workspace.dq = workspace.connection_vector/slowest_joint_time;
+
+  unsigned int iter = std::max(std::ceil(workspace.connection_vector.norm()/max_step_size_),1.0);
+  workspace.delta_q = workspace.connection_vector/iter;
+
+  double forward_sum = 0.0;
+  double backward_sum = 0.0;
+  sumScalingFactorsBothWays(chain,workspace,q1,0,iter+1,forward_sum,backward_sum);
+
+  return std::make_pair(forward_sum/((double) iter+1),backward_sum/((double) iter+1));
+}
+
+void SSM15066Estimator2D::sumScalingFactorsBothWays(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q1, const unsigned int& first,
+                                                    const unsigned int& last, double& forward_sum, double& backward_sum)
+{
+  double forward_scaling_factor_of_q = std::numeric_limits<double>::infinity();
+  double backward_scaling_factor_of_q = std::numeric_limits<double>::infinity();
+  unsigned int samples_to_skip = 0;
+
+  for(unsigned int i=first;i<last;i++)
+  {
+    if(forward_sum == std::numeric_limits<double>::infinity() && backward_sum == std::numeric_limits<double>::infinity())
+      return;
+
+    if(samples_to_skip>0) // the scaling factor is provably not higher than 1+adaptive_sampling_tolerance_ in both directions, see setAdaptiveSampling
+    {
+      samples_to_skip--;
+      forward_sum += 1.0;
+      backward_sum += 1.0;
+      continue;
+    }
+
+    workspace.q = q1+i*workspace.delta_q;
+    computePoiKinematics(chain,workspace.q,workspace.dq,workspace.poi_positions,workspace.poi_velocities);
+
+    /* A poi going toward an obstacle in one direction is going away from it in the other one */
+    if(forward_sum != std::numeric_limits<double>::infinity())
+    {
+      forward_scaling_factor_of_q = computeMaxScalingFactorAtPois(workspace.poi_positions,workspace.poi_velocities,workspace.obstacles_idxs);
+
+      if(forward_scaling_factor_of_q == std::numeric_limits<double>::infinity())
+        forward_sum = std::numeric_limits<double>::infinity();
+      else
+        forward_sum += forward_scaling_factor_of_q;
+    }
+
+    if(backward_sum != std::numeric_limits<double>::infinity())
+    {
+      workspace.reversed_poi_velocities = -workspace.poi_velocities;
+      backward_scaling_factor_of_q = computeMaxScalingFactorAtPois(workspace.poi_positions,workspace.reversed_poi_velocities,workspace.obstacles_idxs);
+
+      if(backward_scaling_factor_of_q == std::numeric_limits<double>::infinity())
+        backward_sum = std::numeric_limits<double>::infinity();
+      else
+        backward_sum += backward_scaling_factor_of_q;
+    }
+
+    if(verbose_>0)
+      ROS_ERROR_STREAM("q "<<workspace.q.transpose()<<" -> scaling factor "<<forward_scaling_factor_of_q<<" forward, "<<backward_scaling_factor_of_q<<" backward");
+
+    if(adaptive_sampling_)
+      samples_to_skip = computeSamplesToSkip(workspace.poi_positions,workspace.dq,workspace.delta_q);
+  }
+}
+
+double SSM15066Estimator2D::computeScalingFactorOfSample(const Eigen::VectorXd& q, const Eigen::VectorXd& dq)
+{
+  computePoiKinematics(chain_,q,dq,workspace_.poi_positions,workspace_.poi_velocities);
+  return computeMaxScalingFactorAtPois(workspace_.poi_positions,workspace_.poi_velocities,workspace_.obstacles_idxs);
+}
+
 double SSM15066Estimator2D::computeScalingFactorAtQ(const Eigen::VectorXd& q, const Eigen::VectorXd& dq)
 {
   Eigen::Vector3d poi_position;
@@ -143,129 +477,253 @@ double SSM15066Estimator2D::computeScalingFactorAtQ(const Eigen::VectorXd& q, co
 double SSM15066Estimator2D::computeScalingFactorAtQ(const Eigen::VectorXd& q, const Eigen::VectorXd& dq, double& tangential_speed, double& distance, double& safe_vel,
                                                     Eigen::Vector3d& poi_position)
 {
-  Eigen::Vector3d this_distance_vector, this_poi_position;
-  double this_distance, this_tangential_speed, this_scaling_factor, max_scaling_factor, v_safety;
+  return computeScalingFactorAtQ(chain_,workspace_,q,dq,tangential_speed,distance,safe_vel,poi_position);
+}
 
-  std::vector<Eigen::Vector6d, Eigen::aligned_allocator<Eigen::Vector6d>> poi_twist_in_base = chain_->getTwist(q,dq);
-  std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d>> poi_poses_in_base = chain_->getTransformations(q);
+double SSM15066Estimator2D::computeScalingFactorAtQ(const rosdyn::ChainPtr& chain, Workspace& workspace, const Eigen::VectorXd& q, const Eigen::VectorXd& dq,
+                                                    double& tangential_speed, double& distance, double& safe_vel, Eigen::Vector3d& poi_position)
+{
+  computePoiKinematics(chain,q,dq,workspace.poi_positions,workspace.poi_velocities);
 
-  max_scaling_factor = 1.0;
-  tangential_speed = 0.0;
-  distance = std::numeric_limits<double>::infinity();
-  safe_vel = std::numeric_limits<double>::infinity();
+  double max_scaling_factor = computeScalingFactorAtPois(workspace.poi_positions,workspace.poi_velocities,tangential_speed,distance,safe_vel,poi_position,
+                                                         workspace.obstacles_idxs);
 
-  for(Eigen::Index i_obs=0;i_obs<obstacles_positions_.cols();i_obs++)
+  if(verbose_>0 && max_scaling_factor<std::numeric_limits<double>::infinity())
   {
-    for(size_t i_poi=0;i_poi<poi_poses_in_base.size();i_poi++)
-    {
-      //consider only links inside the poi_names_ list
-      if(std::find(poi_names_.begin(),poi_names_.end(),frames_names_[i_poi])>=poi_names_.end())
-        continue;
+    ROS_ERROR_STREAM("q "<<q.transpose()<<" -> scaling factor "<<max_scaling_factor);
+    ROS_ERROR("-------- END q -----------");
+  }
 
-      this_poi_position = poi_poses_in_base.at(i_poi).translation();
-      this_distance_vector = obstacles_positions_.col(i_obs)-this_poi_position;
-      this_distance = this_distance_vector.norm();
-      this_tangential_speed = ((poi_twist_in_base.at(i_poi).topLeftCorner(3,1)).dot(this_distance_vector))/this_distance;
+  return max_scaling_factor;
+}
+
+double SSM15066Estimator2D::computeScalingFactorOfPair(const Eigen::Vector3d& obstacle_position, const Eigen::Vector3d& poi_position,
+                                                       const Eigen::Vector3d& poi_velocity, double& tangential_speed, double& distance, double& safe_vel)
+{
+  Eigen::Vector3d distance_vector = obstacle_position-poi_position;
+  distance = distance_vector.norm();
+  tangential_speed = (poi_velocity.dot(distance_vector))/distance;
 
+  if(tangential_speed<=0)  // robot is going away
+  {
+    if(dataset_creation_)
+    {
+      if(distance>min_distance_)
+        safe_vel = safeVelocity(distance);
+      else
+        safe_vel = 0.0;
+    }
+    return 1.0;
+  }
+  else if(distance>min_distance_)
+  {
+    safe_vel = safeVelocity(distance);
+
+    if(safe_vel == 0.0)
+    {
       if(verbose_>0)
       {
-        ROS_ERROR_STREAM("obs n "<< i_obs<<" poi n "<<i_poi<<" distance "<<this_distance<<" tangential speed "<<this_tangential_speed);
+        ROS_ERROR_STREAM("v_safety "<<safe_vel<<" scaling factor inf");
+        ROS_ERROR("-------- END q -----------");
       }
 
-      if(this_tangential_speed<=0)  // robot is going away
-      {
-        this_scaling_factor = 1.0;
-        if(dataset_creation_)
-        {
-          if(this_distance>min_distance_)
-            v_safety = safeVelocity(this_distance);
-          else
-            v_safety = 0.0;
-        }
-      }
-      else if(this_distance>min_distance_)
+      return std::numeric_limits<double>::infinity();
+    }
+
+    assert(safe_vel>=0.0);
+
+    double scaling_factor = std::max(tangential_speed/safe_vel,1.0); // no division by 0
+
+    if(verbose_>0)
+      ROS_ERROR_STREAM("v_safety "<<safe_vel<<" scaling factor "<<scaling_factor);
+
+    return scaling_factor;
+  }
+  else  // distance<=min_distance -> you have found the maximum scaling factor
+  {
+    if(verbose_)
+    {
+      ROS_ERROR("distance <= min_distance -> scaling factor inf");
+      ROS_ERROR("-------- END q -----------");
+    }
+
+    safe_vel = 0.0;
+    return std::numeric_limits<double>::infinity();
+  }
+}
+
+double SSM15066Estimator2D::computeMaxScalingFactorAtPois(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                                          const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                                                          std::vector<Eigen::Index>& obstacles_idxs)
+{
+  if(distance_field_ && verbose_ == 0 && not dataset_creation_)
+    return computeMaxScalingFactorPrefiltered(poi_positions,poi_velocities,obstacles_idxs);
+
+  return computeMaxScalingFactorFromObstacles(poi_positions,poi_velocities,obstacles_idxs);
+}
+
+double SSM15066Estimator2D::computeMaxScalingFactorFromObstacles(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                                                 const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                                                                 std::vector<Eigen::Index>& obstacles_idxs)
+{
+  if(verbose_>0 || dataset_creation_ || useObstaclesIndex())
+  {
+    Eigen::Vector3d poi_position;
+    double distance, tangential_speed, safe_vel;
+    return computeScalingFactorAtPois(poi_positions,poi_velocities,tangential_speed,distance,safe_vel,poi_position,obstacles_idxs);
+  }
+
+  return scaling_factor_kernel_.computeMaxScalingFactor(poi_positions,poi_velocities,min_distance_,max_cart_acc_,term1_,term2_);
+}
+
+double SSM15066Estimator2D::computeMaxScalingFactorPrefiltered(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                                             const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                                                             std::vector<Eigen::Index>& obstacles_idxs)
+{
+  double lower_bound, scaling_factor;
+  double max_scaling_factor = 1.0;
+
+  for(Eigen::Index i_poi=0;i_poi<poi_positions.cols();i_poi++)
+  {
+    /* Farther obstacles than the influence distance have a safe velocity higher than the poi speed (see computeInfluenceDistance) */
+    if(distance_field_->lowerBound(poi_positions.col(i_poi),lower_bound) &&
+       lower_bound>computeInfluenceDistance(poi_velocities.col(i_poi).norm()))
+      continue;
+
+    scaling_factor = computeMaxScalingFactorFromObstacles(poi_positions.col(i_poi),poi_velocities.col(i_poi),obstacles_idxs);
+
+    if(scaling_factor == std::numeric_limits<double>::infinity())
+      return scaling_factor;
+
+    max_scaling_factor = std::max(max_scaling_factor,scaling_factor);
+  }
+
+  return max_scaling_factor;
+}
+
+double SSM15066Estimator2D::computeScalingFactorAtPois(const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_positions,
+                                                       const Eigen::Ref<const Eigen::Matrix<double,3,Eigen::Dynamic>>& poi_velocities,
+                                                       double& tangential_speed, double& distance, double& safe_vel, Eigen::Vector3d& poi_position,
+                                                       std::vector<Eigen::Index>& obstacles_idxs)
+{
+  double this_distance, this_tangential_speed, this_scaling_factor, max_scaling_factor, v_safety;
+
+  max_scaling_factor = 1.0;
+  tangential_speed = 0.0;
+  distance = std::numeric_limits<double>::infinity();
+  safe_vel = std::numeric_limits<double>::infinity();
+
+  if(dataset_creation_ || not useObstaclesIndex())
+  {
+    for(Eigen::Index i_obs=0;i_obs<obstacles_positions_.cols();i_obs++)
+    {
+      for(Eigen::Index i_poi=0;i_poi<poi_positions.cols();i_poi++)
       {
-        v_safety = safeVelocity(this_distance);
+        this_scaling_factor = computeScalingFactorOfPair(obstacles_positions_.col(i_obs),poi_positions.col(i_poi),poi_velocities.col(i_poi),
+                                                         this_tangential_speed,this_distance,v_safety);
 
-        if(v_safety == 0.0)
-        {
-          if(verbose_>0)
-          {
-            ROS_ERROR_STREAM("v_safety "<<v_safety<<" scaling factor inf");
-            ROS_ERROR("-------- END q -----------");
-          }
+        if(verbose_>0)
+          ROS_ERROR_STREAM("obs n "<< i_obs<<" poi n "<<i_poi<<" distance "<<this_distance<<" tangential speed "<<this_tangential_speed<<" scaling factor "<<this_scaling_factor);
 
+        if(this_scaling_factor>=max_scaling_factor) //= to update distance and tangential speed outputs
+        {
           safe_vel = v_safety;
           distance = this_distance;
-          poi_position = this_poi_position;
+          poi_position = poi_positions.col(i_poi);
+          max_scaling_factor = this_scaling_factor;
           tangential_speed = this_tangential_speed;
-          return std::numeric_limits<double>::infinity();
-        }
-        else
-        {
-          this_scaling_factor = std::max(this_tangential_speed/v_safety,1.0); // no division by 0
+
+          if(max_scaling_factor == std::numeric_limits<double>::infinity())
+            return max_scaling_factor;
         }
+      } // end robot poi for-loop
+    } // end obstacles for-loop
+  }
+  else
+  {
+    double poi_speed;
 
-        if(verbose_>0)
-          ROS_ERROR_STREAM("v_safety "<<v_safety<<" scaling factor "<<this_scaling_factor);
+    for(Eigen::Index i_poi=0;i_poi<poi_positions.cols();i_poi++)
+    {
+      poi_speed = poi_velocities.col(i_poi).norm();
+      if(poi_speed == 0.0)  // the tangential speed is zero w.r.t. every obstacle
+        continue;
 
-        assert(v_safety>=0.0);
-      }
-      else  // distance<=min_distance -> you have found the maximum scaling factor, return
+      /* Farther obstacles have a safe velocity higher than the poi speed */
+      obstacles_index_->radiusSearch(poi_positions.col(i_poi),computeInfluenceDistance(poi_speed),obstacles_idxs);
+
+      for(const Eigen::Index& i_obs: obstacles_idxs)
       {
-        if(verbose_)
+        this_scaling_factor = computeScalingFactorOfPair(obstacles_positions_.col(i_obs),poi_positions.col(i_poi),poi_velocities.col(i_poi),
+                                                         this_tangential_speed,this_distance,v_safety);
+
+        if(verbose_>0)
+          ROS_ERROR_STREAM("obs n "<< i_obs<<" poi n "<<i_poi<<" distance "<<this_distance<<" tangential speed "<<this_tangential_speed<<" scaling factor "<<this_scaling_factor);
+
+        if(this_scaling_factor>max_scaling_factor)
         {
-          ROS_ERROR("distance <= min_distance -> scaling factor inf");
-          ROS_ERROR("-------- END q -----------");
-        }
+          safe_vel = v_safety;
+          distance = this_distance;
+          poi_position = poi_positions.col(i_poi);
+          max_scaling_factor = this_scaling_factor;
+          tangential_speed = this_tangential_speed;
 
-        safe_vel = 0.0;
-        distance = this_distance;
-        poi_position = this_poi_position;
-        tangential_speed = this_tangential_speed;
-        return std::numeric_limits<double>::infinity();
+          if(max_scaling_factor == std::numeric_limits<double>::infinity())
+            return max_scaling_factor;
+        }
       }
+    }
+  }
 
-      if(this_scaling_factor>=max_scaling_factor) //= to update distance and tangential speed outputs
-      {
-        safe_vel = v_safety;
-        distance = this_distance;
-        poi_position = this_poi_position;
-        max_scaling_factor = this_scaling_factor;
-        tangential_speed = this_tangential_speed;
-      }
+  return max_scaling_factor;
+}
 
-      if(verbose_>0)
-      {
-        ROS_ERROR_STREAM("scaling factor "<<this_scaling_factor);
-        ROS_ERROR("---");
-      }
-    } // end robot poi for-loop
-  } // end obstacles for-loop
+double SSM15066Estimator2D::computeScalingFactorFromKinematics(const EdgeKinematics& kinematics)
+{
+  return computeScalingFactorFromKinematics(workspace_,kinematics);
+}
 
-  if(verbose_>0)
+double SSM15066Estimator2D::computeScalingFactorFromKinematics(Workspace& workspace, const EdgeKinematics& kinematics)
+{
+  if(obstacles_positions_.cols()==0)  //no obstacles in the scene
+    return 1.0;
+
+  assert(kinematics.n_pois_ == poi_idxs_.size());
+
+  double max_scaling_factor_of_q;
+  double sum_scaling_factor = 0.0;
+
+  for(unsigned int i=0;i<kinematics.n_samples_;i++)
   {
-    ROS_ERROR_STREAM("q "<<q.transpose()<<" -> scaling factor "<<max_scaling_factor);
-    ROS_ERROR("-------- END q -----------");
+    max_scaling_factor_of_q = computeMaxScalingFactorAtPois(kinematics.poi_positions_ .middleCols(i*kinematics.n_pois_,kinematics.n_pois_),
+                                                            kinematics.poi_velocities_.middleCols(i*kinematics.n_pois_,kinematics.n_pois_),
+                                                            workspace.obstacles_idxs);
+    if(max_scaling_factor_of_q == std::numeric_limits<double>::infinity())
+      return std::numeric_limits<double>::infinity();
+    else
+      sum_scaling_factor += max_scaling_factor_of_q;
   }
 
-  return max_scaling_factor;
+  // return the average scaling factor
+  double res = sum_scaling_factor/((double) kinematics.n_samples_);
+  assert(res>=1.0);
+
+  return res;
 }
 
-pathplan::CostPenaltyPtr SSM15066Estimator2D::clone()
+void SSM15066Estimator2D::copySettingsTo(SSM15066Estimator& other)
 {
-  SSM15066Estimator2DPtr ssm_cloned = std::make_shared<SSM15066Estimator2D>(chain_->clone(),max_step_size_);
-
-  ssm_cloned->setPoiNames(poi_names_);
-  ssm_cloned->setMaxStepSize(max_step_size_);
-  ssm_cloned->setObstaclesPositions(obstacles_positions_);
+  SSM15066Estimator::copySettingsTo(other);
 
-  ssm_cloned->setMaxCartAcc(max_cart_acc_,false);
-  ssm_cloned->setMinDistance(min_distance_,false);
-  ssm_cloned->setReactionTime(reaction_time_,false);
-  ssm_cloned->setHumanVelocity(human_velocity_,false);
+  SSM15066Estimator2D& other_2d = static_cast<SSM15066Estimator2D&>(other);
+  other_2d.setDatasetCreation(dataset_creation_);
+  other_2d.setKinematicsInterpolation(kinematics_interpolation_,anchors_stride_,interpolation_position_tolerance_,interpolation_velocity_tolerance_);
+}
 
-  ssm_cloned->updateMembers();
+pathplan::CostPenaltyPtr SSM15066Estimator2D::clone()
+{
+  SSM15066Estimator2DPtr ssm_cloned = std::make_shared<SSM15066Estimator2D>(chain_->clone(),max_step_size_);
+  copySettingsTo(*ssm_cloned);
 
   pathplan::CostPenaltyPtr clone = ssm_cloned;
 
@@ -0,0 +1,194 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <ssm15066_estimators/swept_volume_index.h>
+
+namespace ssm15066_estimator
+{
+SweptVolumeIndex::SweptVolumeIndex(const double& influence_radius, const double& cell_size):
+  cell_size_(cell_size),influence_radius_(influence_radius)
+{
+  if(cell_size_<=0.0)
+  {
+    ROS_ERROR("cell size must be positive, set equal to 0.20");
+    cell_size_ = 0.20;
+  }
+}
+
+Eigen::Vector3i SweptVolumeIndex::cellOf(const Eigen::Vector3d& point) const
+{
+  return (point/cell_size_).array().floor().cast<int>();
+}
+
+uint64_t SweptVolumeIndex::cellKey(const Eigen::Vector3i& cell) const
+{
+  /* 21 bits for each coordinate, offset to make them non-negative */
+  const uint64_t mask = (1ULL<<21)-1;
+  const int64_t offset = 1LL<<20;
+
+  return (((uint64_t) (cell.x()+offset) & mask)<<42) | (((uint64_t) (cell.y()+offset) & mask)<<21) | ((uint64_t) (cell.z()+offset) & mask);
+}
+
+void SweptVolumeIndex::insert(const size_t& id, const Eigen::Vector3d& min_corner, const Eigen::Vector3d& max_corner)
+{
+  erase(id);
+
+  Box box;
+  box.min_ = min_corner;
+  box.max_ = max_corner;
+
+  Eigen::Vector3i min_cell = cellOf(min_corner);
+  Eigen::Vector3i max_cell = cellOf(max_corner);
+
+  uint64_t key;
+  for(int x=min_cell.x();x<=max_cell.x();x++)
+  {
+    for(int y=min_cell.y();y<=max_cell.y();y++)
+    {
+      for(int z=min_cell.z();z<=max_cell.z();z++)
+      {
+        key = cellKey(Eigen::Vector3i(x,y,z));
+        grid_[key].push_back(id);
+        box.cells_.push_back(key);
+      }
+    }
+  }
+
+  boxes_[id] = box;
+}
+
+void SweptVolumeIndex::insert(const size_t& id, const EdgeKinematics& kinematics)
+{
+  if(kinematics.poi_positions_.cols() == 0)
+    return;
+
+  insert(id,kinematics.poi_positions_.rowwise().minCoeff(),kinematics.poi_positions_.rowwise().maxCoeff());
+}
+
+void SweptVolumeIndex::erase(const size_t& id)
+{
+  auto it = boxes_.find(id);
+  if(it == boxes_.end())
+    return;
+
+  for(const uint64_t& key:it->second.cells_)
+  {
+    std::vector<size_t>& ids = grid_[key];
+    ids.erase(std::remove(ids.begin(),ids.end(),id),ids.end());
+
+    if(ids.empty())
+      grid_.erase(key);
+  }
+
+  boxes_.erase(it);
+}
+
+void SweptVolumeIndex::clear()
+{
+  grid_.clear();
+  boxes_.clear();
+}
+
+void SweptVolumeIndex::collect(const Eigen::Vector3d& point, std::unordered_set<size_t>& ids) const
+{
+  Eigen::Vector3d radius = Eigen::Vector3d::Constant(influence_radius_);
+  Eigen::Vector3i min_cell = cellOf(point-radius);
+  Eigen::Vector3i max_cell = cellOf(point+radius);
+
+  double squared_radius = influence_radius_*influence_radius_;
+
+  for(int x=min_cell.x();x<=max_cell.x();x++)
+  {
+    for(int y=min_cell.y();y<=max_cell.y();y++)
+    {
+      for(int z=min_cell.z();z<=max_cell.z();z++)
+      {
+        auto it = grid_.find(cellKey(Eigen::Vector3i(x,y,z)));
+        if(it == grid_.end())
+          continue;
+
+        for(const size_t& id:it->second)
+        {
+          if(ids.find(id) != ids.end())
+            continue;
+
+          /* Point-box distance */
+          const Box& box = boxes_.at(id);
+          Eigen::Vector3d closest = point.cwiseMax(box.min_).cwiseMin(box.max_);
+          if((point-closest).squaredNorm()<=squared_radius)
+            ids.insert(id);
+        }
+      }
+    }
+  }
+}
+
+std::vector<size_t> SweptVolumeIndex::query(const Eigen::Vector3d& point) const
+{
+  std::unordered_set<size_t> ids;
+  collect(point,ids);
+
+  std::vector<size_t> res(ids.begin(),ids.end());
+  std::sort(res.begin(),res.end());
+
+  return res;
+}
+
+std::vector<size_t> SweptVolumeIndex::findInvalidatedConnections(const Eigen::Matrix<double,3,Eigen::Dynamic>& old_obstacles_positions,
+                                                                 const Eigen::Matrix<double,3,Eigen::Dynamic>& new_obstacles_positions,
+                                                                 const double& tolerance) const
+{
+  std::unordered_set<size_t> ids;
+
+  if(old_obstacles_positions.cols() != new_obstacles_positions.cols())
+  {
+    for(Eigen::Index i=0;i<old_obstacles_positions.cols();i++)
+      collect(old_obstacles_positions.col(i),ids);
+
+    for(Eigen::Index i=0;i<new_obstacles_positions.cols();i++)
+      collect(new_obstacles_positions.col(i),ids);
+  }
+  else
+  {
+    for(Eigen::Index i=0;i<new_obstacles_positions.cols();i++)
+    {
+      if((new_obstacles_positions.col(i)-old_obstacles_positions.col(i)).norm()<=tolerance)
+        continue;
+
+      collect(old_obstacles_positions.col(i),ids);
+      collect(new_obstacles_positions.col(i),ids);
+    }
+  }
+
+  std::vector<size_t> res(ids.begin(),ids.end());
+  std::sort(res.begin(),res.end());
+
+  return res;
+}
+
+}
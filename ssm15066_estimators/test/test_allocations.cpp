@@ -0,0 +1,220 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <gtest/gtest.h>
+#include <urdf/model.h>
+#include <ssm15066_estimators/ssm15066_estimator1D.h>
+#include <ssm15066_estimators/ssm15066_estimator2D.h>
+#include <atomic>
+#include <new>
+#include <random>
+
+/* Every heap allocation of the process is counted while allocations_counting is true: operator new is replaced, and malloc and realloc are
+ * replaced too since Eigen allocates the dynamic-size matrices with them (glibc exports its implementations as __libc_malloc, __libc_realloc and __libc_free) */
+static std::atomic<bool> allocations_counting(false);
+static std::atomic<unsigned long> allocations(0);
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void __libc_free(void* ptr);
+
+extern "C" void* malloc(size_t size)
+{
+  if(allocations_counting)
+    allocations++;
+  return __libc_malloc(size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+  if(allocations_counting)
+    allocations++;
+  return __libc_realloc(ptr,size);
+}
+
+void* operator new(std::size_t size)
+{
+  if(allocations_counting)
+    allocations++;
+
+  void* ptr = __libc_malloc(size>0? size: 1);
+  if(ptr == nullptr)
+    throw std::bad_alloc();
+
+  return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  __libc_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  __libc_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  __libc_free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+  __libc_free(ptr);
+}
+
+namespace ssm15066_estimator
+{
+
+static const std::string robot_description = R"(
+<robot name="test_robot">
+  <link name="base_link"/>
+  <link name="link1"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint1" type="revolute"><parent link="base_link"/><child link="link1"/><origin xyz="0 0 0.3" rpy="0 0 0"/><axis xyz="0 0 1"/><limit lower="-3.14" upper="3.14" effort="100" velocity="1.5"/></joint>
+  <link name="link2"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint2" type="revolute"><parent link="link1"/><child link="link2"/><origin xyz="0 0 0.25" rpy="0 0 0"/><axis xyz="0 1 0"/><limit lower="-3.14" upper="3.14" effort="100" velocity="1.7"/></joint>
+  <link name="link3"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint3" type="revolute"><parent link="link2"/><child link="link3"/><origin xyz="0 0 0.25" rpy="0 0 0"/><axis xyz="1 0 0"/><limit lower="-3.14" upper="3.14" effort="100" velocity="1.9"/></joint>
+  <link name="link4"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint4" type="revolute"><parent link="link3"/><child link="link4"/><origin xyz="0 0 0.25" rpy="0 0 0"/><axis xyz="0 0 1"/><limit lower="-3.14" upper="3.14" effort="100" velocity="2.1"/></joint>
+  <link name="link5"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint5" type="revolute"><parent link="link4"/><child link="link5"/><origin xyz="0 0 0.25" rpy="0 0 0"/><axis xyz="0 1 0"/><limit lower="-3.14" upper="3.14" effort="100" velocity="2.3"/></joint>
+  <link name="link6"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint6" type="revolute"><parent link="link5"/><child link="link6"/><origin xyz="0 0 0.25" rpy="0 0 0"/><axis xyz="1 0 0"/><limit lower="-3.14" upper="3.14" effort="100" velocity="2.5"/></joint>
+</robot>)";
+
+class AllocationsTest: public ::testing::Test
+{
+protected:
+  rosdyn::ChainPtr chain_;
+  Eigen::Matrix<double,3,Eigen::Dynamic> obstacles_positions_;
+  std::vector<std::pair<Eigen::VectorXd,Eigen::VectorXd>> connections_;
+
+  void SetUp() override
+  {
+#ifndef NDEBUG
+    GTEST_SKIP() << "the assertions of the estimators allocate temporary vectors, build without them (NDEBUG)";
+#endif
+
+    urdf::Model model;
+    ASSERT_TRUE(model.initString(robot_description));
+    chain_ = rosdyn::createChain(model,"base_link","link6",Eigen::Vector3d(0.0,0.0,-9.806));
+    ASSERT_TRUE(chain_ != nullptr);
+
+    obstacles_positions_.resize(3,3);
+    obstacles_positions_ << 1.2,0.9,-1.0,
+                            0.4,-0.8,1.1,
+                            1.2,1.4,0.9;
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> distribution(-2.0,2.0);
+    Eigen::VectorXd q1(6), q2(6);
+    for(unsigned int i=0;i<100;i++)
+    {
+      for(unsigned int j=0;j<6;j++)
+      {
+        q1(j) = distribution(generator);
+        q2(j) = 0.5*distribution(generator);
+      }
+      connections_.push_back(std::make_pair(q1,q2));
+    }
+  }
+
+  /**
+   * @brief countAllocations evaluates every connection once to allocate the buffers, then it returns the heap allocations of evaluating them again.
+   */
+  unsigned long countAllocations(const SSM15066EstimatorPtr& estimator)
+  {
+    double sum = 0.0;
+    for(const std::pair<Eigen::VectorXd,Eigen::VectorXd>& connection: connections_)
+      sum += estimator->computeScalingFactor(connection.first,connection.second);
+
+    allocations = 0;
+    allocations_counting = true;
+    for(const std::pair<Eigen::VectorXd,Eigen::VectorXd>& connection: connections_)
+      sum += estimator->computeScalingFactor(connection.first,connection.second);
+    allocations_counting = false;
+
+    EXPECT_GT(sum,0.0);
+    return allocations;
+  }
+};
+
+TEST_F(AllocationsTest, SSM15066Estimator2D)
+{
+  SSM15066Estimator2DPtr estimator = std::make_shared<SSM15066Estimator2D>(chain_,0.05,obstacles_positions_);
+  EXPECT_EQ(countAllocations(estimator),0u);
+
+  estimator->setAdaptiveSampling(true,0.05);
+  estimator->setQuickAccept(true);
+  EXPECT_EQ(countAllocations(estimator),0u);
+
+  estimator->setQuadrature(true);
+  EXPECT_EQ(countAllocations(estimator),0u);
+}
+
+TEST_F(AllocationsTest, SSM15066Estimator2DObstaclesIndex)
+{
+  SSM15066Estimator2DPtr estimator = std::make_shared<SSM15066Estimator2D>(chain_,0.05,obstacles_positions_);
+  estimator->setObstaclesIndexThreshold(1);
+  EXPECT_EQ(countAllocations(estimator),0u);
+}
+
+TEST_F(AllocationsTest, SSM15066Estimator2DDistanceField)
+{
+  SSM15066Estimator2DPtr estimator = std::make_shared<SSM15066Estimator2D>(chain_,0.05,obstacles_positions_);
+  estimator->setDistanceField(Eigen::Vector3d(-2.0,-2.0,-1.0),Eigen::Vector3d(2.0,2.0,2.5),0.05);
+  EXPECT_EQ(countAllocations(estimator),0u);
+}
+
+TEST_F(AllocationsTest, SSM15066Estimator1D)
+{
+  SSM15066Estimator1DPtr estimator = std::make_shared<SSM15066Estimator1D>(chain_,0.05,obstacles_positions_);
+  EXPECT_EQ(countAllocations(estimator),0u);
+
+  estimator->setAdaptiveSampling(true,0.05);
+  estimator->setQuickAccept(true);
+  EXPECT_EQ(countAllocations(estimator),0u);
+
+  estimator->setQuadrature(true);
+  EXPECT_EQ(countAllocations(estimator),0u);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,170 @@
+/*
+Copyright (c) 2023, Cesare Tonola University of Brescia c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <gtest/gtest.h>
+#include <urdf/model.h>
+#include <ssm15066_estimators/cascaded_ssm15066_estimator.h>
+#include <random>
+
+namespace ssm15066_estimator
+{
+
+static const std::string robot_description = R"(
+<robot name="test_robot">
+  <link name="base_link"/>
+  <link name="link1"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint1" type="revolute"><parent link="base_link"/><child link="link1"/><origin xyz="0 0 0.3" rpy="0 0 0"/><axis xyz="0 0 1"/><limit lower="-3.14" upper="3.14" effort="100" velocity="1.5"/></joint>
+  <link name="link2"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint2" type="revolute"><parent link="link1"/><child link="link2"/><origin xyz="0 0 0.25" rpy="0 0 0"/><axis xyz="0 1 0"/><limit lower="-3.14" upper="3.14" effort="100" velocity="1.7"/></joint>
+  <link name="link3"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint3" type="revolute"><parent link="link2"/><child link="link3"/><origin xyz="0 0 0.25" rpy="0 0 0"/><axis xyz="1 0 0"/><limit lower="-3.14" upper="3.14" effort="100" velocity="1.9"/></joint>
+  <link name="link4"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint4" type="revolute"><parent link="link3"/><child link="link4"/><origin xyz="0 0 0.25" rpy="0 0 0"/><axis xyz="0 0 1"/><limit lower="-3.14" upper="3.14" effort="100" velocity="2.1"/></joint>
+  <link name="link5"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint5" type="revolute"><parent link="link4"/><child link="link5"/><origin xyz="0 0 0.25" rpy="0 0 0"/><axis xyz="0 1 0"/><limit lower="-3.14" upper="3.14" effort="100" velocity="2.3"/></joint>
+  <link name="link6"><inertial><mass value="1.0"/><inertia ixx="0.01" ixy="0" ixz="0" iyy="0.01" iyz="0" izz="0.01"/></inertial></link>
+  <joint name="joint6" type="revolute"><parent link="link5"/><child link="link6"/><origin xyz="0 0 0.25" rpy="0 0 0"/><axis xyz="1 0 0"/><limit lower="-3.14" upper="3.14" effort="100" velocity="2.5"/></joint>
+</robot>)";
+
+class CascadedEstimatorTest: public ::testing::Test
+{
+protected:
+  rosdyn::ChainPtr chain_;
+  pathplan::ConfigurationsPairs connections_;
+
+  void SetUp() override
+  {
+    urdf::Model model;
+    ASSERT_TRUE(model.initString(robot_description));
+    chain_ = rosdyn::createChain(model,"base_link","link6",Eigen::Vector3d(0.0,0.0,-9.806));
+    ASSERT_TRUE(chain_ != nullptr);
+
+    /* Long and short random connections, so that some of them are far from the obstacles */
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> distribution(-2.0,2.0);
+    std::uniform_real_distribution<double> length(0.02,1.0);
+    Eigen::VectorXd q1(6), q2(6);
+    for(unsigned int i=0;i<200;i++)
+    {
+      for(unsigned int j=0;j<6;j++)
+      {
+        q1(j) = distribution(generator);
+        q2(j) = 0.5*distribution(generator);
+      }
+      connections_.push_back(std::make_pair(q1,q2));
+      connections_.push_back(std::make_pair(q1,Eigen::VectorXd(q1+length(generator)*(q2-q1))));
+    }
+  }
+
+  Eigen::Matrix<double,3,Eigen::Dynamic> obstaclesPositions(const double& scale)
+  {
+    Eigen::Matrix<double,3,Eigen::Dynamic> obstacles_positions(3,3);
+    obstacles_positions << 1.2,0.9,-1.0,
+                           0.4,-0.8,1.1,
+                           1.2,1.4,0.9;
+    return scale*obstacles_positions;
+  }
+
+  /**
+   * @brief expectSameScalingFactors compares the penalties of the cascade, one connection at a time and as a batch, with the scaling factors of
+   * the 2D estimator alone.
+   */
+  void expectSameScalingFactors(const CascadedSSM15066EstimatorPtr& cascade, const SSM15066Estimator2DPtr& estimator)
+  {
+    std::vector<double> penalties = cascade->computePenalties(connections_);
+    ASSERT_EQ(penalties.size(),connections_.size());
+
+    double scaling_factor;
+    for(size_t i=0;i<connections_.size();i++)
+    {
+      scaling_factor = estimator->computeScalingFactor(connections_[i].first,connections_[i].second);
+      if(scaling_factor == std::numeric_limits<double>::infinity())
+      {
+        EXPECT_EQ(cascade->computePenalty(connections_[i].first,connections_[i].second),scaling_factor);
+        EXPECT_EQ(penalties[i],scaling_factor);
+      }
+      else
+      {
+        EXPECT_NEAR(cascade->computePenalty(connections_[i].first,connections_[i].second),scaling_factor,1e-09*scaling_factor);
+        EXPECT_NEAR(penalties[i],scaling_factor,1e-09*scaling_factor);
+      }
+    }
+  }
+};
+
+TEST_F(CascadedEstimatorTest, SameScalingFactorsOf2D)
+{
+  for(const double& scale: {0.6,1.0,2.5})
+  {
+    SSM15066Estimator2DPtr estimator = std::make_shared<SSM15066Estimator2D>(chain_->clone(),0.05,obstaclesPositions(scale));
+    SSM15066Estimator2DPtr reference = std::make_shared<SSM15066Estimator2D>(chain_->clone(),0.05,obstaclesPositions(scale));
+    CascadedSSM15066EstimatorPtr cascade = std::make_shared<CascadedSSM15066Estimator>(estimator);
+
+    expectSameScalingFactors(cascade,reference);
+    EXPECT_EQ(cascade->getConnections(),2*connections_.size());
+  }
+}
+
+TEST_F(CascadedEstimatorTest, SameScalingFactorsOfParallel2D)
+{
+  for(const double& scale: {0.6,1.0,2.5})
+  {
+    ParallelSSM15066Estimator2DPtr estimator = std::make_shared<ParallelSSM15066Estimator2D>(chain_->clone(),0.05,obstaclesPositions(scale),4);
+    SSM15066Estimator2DPtr reference = std::make_shared<SSM15066Estimator2D>(chain_->clone(),0.05,obstaclesPositions(scale));
+    CascadedSSM15066EstimatorPtr cascade = std::make_shared<CascadedSSM15066Estimator>(estimator);
+
+    /* The bounds run on the threads of the 2D estimator */
+    ParallelSSM15066Estimator1DPtr bound_estimator = std::dynamic_pointer_cast<ParallelSSM15066Estimator1D>(cascade->getBoundEstimator());
+    ASSERT_TRUE(bound_estimator != nullptr);
+    EXPECT_EQ(bound_estimator->getThreadPool(),estimator->getScheduler()->getUsedPool());
+
+    expectSameScalingFactors(cascade,reference);
+  }
+}
+
+TEST_F(CascadedEstimatorTest, SameScalingFactorsOf2DWithQuadrature)
+{
+  for(const double& scale: {0.6,1.0,2.5})
+  {
+    SSM15066Estimator2DPtr estimator = std::make_shared<SSM15066Estimator2D>(chain_->clone(),0.05,obstaclesPositions(scale));
+    SSM15066Estimator2DPtr reference = std::make_shared<SSM15066Estimator2D>(chain_->clone(),0.05,obstaclesPositions(scale));
+    estimator->setQuadrature(true,1e-02,1e-02);
+    reference->setQuadrature(true,1e-02,1e-02);
+    CascadedSSM15066EstimatorPtr cascade = std::make_shared<CascadedSSM15066Estimator>(estimator);
+
+    /* The quadrature nodes are not bounded by the 1D samples, no connection is accepted by the bound */
+    expectSameScalingFactors(cascade,reference);
+    EXPECT_EQ(cascade->getBoundAccepts(),0u);
+  }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}